@@ -0,0 +1,421 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "bench.h"
+#include "io/net_config_loader.h"
+#include "io/dataset_loader.h"
+#include "maths/simd.h"
+
+const char* bench_datasets[] = {"xor", "iris", "iot_intrusion"};
+const int num_bench_datasets = sizeof(bench_datasets) / sizeof(bench_datasets[0]);
+
+#define MAX_SAMPLES 31
+#define SAMPLE_SECONDS 0.002 // Minimum duration of each sample, so that short calls are timed over many runs
+#define WARMUP_SECONDS 0.02
+#define MAX_BENCH_SECONDS 0.5 // Fewer samples are taken of calls too slow to take MAX_SAMPLES in this time
+#define MIN_SAMPLES 5
+
+typedef struct BenchResult {
+    char suite[32];
+    char name[64];
+    char shape[48];
+    int samples;
+    long iterations; // Calls per sample
+    double median_seconds;
+    double p95_seconds;
+    double min_seconds;
+    double flops;
+    double bytes;
+} BenchResult;
+
+typedef struct ErrorResult {
+    char suite[32];
+    char name[64];
+    char range[48];
+    double max_ulp;
+    double max_abs;
+    double ulp_bound; // Or 0 if not bounded in ulp
+    double abs_bound; // Or 0 if not bounded in absolute error
+    int passed;
+} ErrorResult;
+
+typedef struct AccuracyResult {
+    char suite[32];
+    char name[64];
+    char dataset[48];
+    double accuracy;
+    double compared_accuracy;
+    double tolerance;
+    int passed;
+} AccuracyResult;
+
+static BenchResult* results = NULL;
+static int num_results = 0;
+static int results_capacity = 0;
+static ErrorResult* errors = NULL;
+static int num_errors = 0;
+static int errors_capacity = 0;
+static AccuracyResult* accuracies = NULL;
+static int num_accuracies = 0;
+static int accuracies_capacity = 0;
+static int num_failed_errors = 0;
+static const char* filter = NULL;
+
+static double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+int bench_selected(const char* suite, const char* name) {
+    // A benchmark matches if the filter is a substring of "suite/name", or there is no filter.
+    if (filter == NULL) {
+        return 1;
+    }
+    char full_name[128];
+    snprintf(full_name, sizeof(full_name), "%s/%s", suite, name);
+    return strstr(full_name, filter) != NULL;
+}
+
+static void format_time(char* buffer, double seconds) {
+    if (seconds < 1e-6) {
+        sprintf(buffer, "%7.1f ns", seconds * 1e9);
+    }
+    else if (seconds < 1e-3) {
+        sprintf(buffer, "%7.2f us", seconds * 1e6);
+    }
+    else if (seconds < 1.0) {
+        sprintf(buffer, "%7.2f ms", seconds * 1e3);
+    }
+    else {
+        sprintf(buffer, "%7.3f s ", seconds);
+    }
+}
+
+static void record_result(const BenchResult* result) {
+    if (num_results == results_capacity) {
+        int capacity = (results_capacity == 0) ? 64 : 2 * results_capacity;
+        BenchResult* grown = realloc(results, capacity * sizeof(BenchResult));
+        if (grown == NULL) {
+            return;
+        }
+        results = grown;
+        results_capacity = capacity;
+    }
+    results[num_results++] = *result;
+}
+
+void bench_run(const char* suite, const char* name, const char* shape, BenchFunc fn, void* arg, double flops,
+    double bytes) {
+    if (!bench_selected(suite, name)) {
+        return;
+    }
+
+    // Warming up, and estimating the time per call from the warmup runs.
+    long warmup_calls = 0;
+    double start = now_seconds(), elapsed;
+    do {
+        fn(arg);
+        warmup_calls++;
+        elapsed = now_seconds() - start;
+    } while (elapsed < WARMUP_SECONDS && warmup_calls < 1000000);
+    double estimate = elapsed / warmup_calls;
+
+    long iterations = (estimate > 0) ? (long)(SAMPLE_SECONDS / estimate) + 1 : 1;
+    int samples = (int)(MAX_BENCH_SECONDS / (estimate * iterations));
+    samples = (samples > MAX_SAMPLES) ? MAX_SAMPLES : (samples < MIN_SAMPLES) ? MIN_SAMPLES : samples;
+
+    double times[MAX_SAMPLES];
+    for (int s=0; s < samples; s++) {
+        start = now_seconds();
+        for (long i=0; i < iterations; i++) {
+            fn(arg);
+        }
+        times[s] = (now_seconds() - start) / iterations;
+    }
+    qsort(times, samples, sizeof(double), compare_doubles);
+
+    BenchResult result;
+    snprintf(result.suite, sizeof(result.suite), "%s", suite);
+    snprintf(result.name, sizeof(result.name), "%s", name);
+    snprintf(result.shape, sizeof(result.shape), "%s", shape);
+    result.samples = samples;
+    result.iterations = iterations;
+    result.median_seconds = (samples % 2 == 1) ? times[samples / 2] :
+        0.5 * (times[samples / 2 - 1] + times[samples / 2]);
+    result.p95_seconds = times[(int)(0.95 * samples + 0.999999) - 1]; // Nearest-rank percentile
+    result.min_seconds = times[0];
+    result.flops = flops;
+    result.bytes = bytes;
+    record_result(&result);
+
+    // Throughputs are given for the median time.
+    char median[16], p95[16];
+    format_time(median, result.median_seconds);
+    format_time(p95, result.p95_seconds);
+    printf("%-11s %-38s %-14s median %s   p95 %s", suite, name, shape, median, p95);
+    if (flops > 0) {
+        printf("   %8.3f GFLOP/s", flops / result.median_seconds * 1e-9);
+    }
+    if (bytes > 0) {
+        printf("   %8.3f GB/s", bytes / result.median_seconds * 1e-9);
+    }
+    printf("\n");
+}
+
+void bench_report_error(const char* suite, const char* name, const char* range, double max_ulp, double max_abs,
+    double ulp_bound, double abs_bound) {
+    if (!bench_selected(suite, name)) {
+        return;
+    }
+
+    // Checked before recording, so that a failure is counted even if there is no room to record it.
+    int passed = (ulp_bound <= 0 || max_ulp <= ulp_bound) && (abs_bound <= 0 || max_abs <= abs_bound);
+    if (!passed) {
+        num_failed_errors++;
+    }
+
+    if (num_errors == errors_capacity) {
+        int capacity = (errors_capacity == 0) ? 16 : 2 * errors_capacity;
+        ErrorResult* grown = realloc(errors, capacity * sizeof(ErrorResult));
+        if (grown == NULL) {
+            return;
+        }
+        errors = grown;
+        errors_capacity = capacity;
+    }
+    ErrorResult* error = &errors[num_errors++];
+    snprintf(error->suite, sizeof(error->suite), "%s", suite);
+    snprintf(error->name, sizeof(error->name), "%s", name);
+    snprintf(error->range, sizeof(error->range), "%s", range);
+    error->max_ulp = max_ulp;
+    error->max_abs = max_abs;
+    error->ulp_bound = ulp_bound;
+    error->abs_bound = abs_bound;
+    error->passed = passed;
+
+    printf("%-11s %-38s %-14s max error %8.3f ulp   %10.3e abs", suite, name, range, max_ulp, max_abs);
+    if (!passed) {
+        printf("   FAILED, bound %g ulp %g abs", ulp_bound, abs_bound);
+    }
+    printf("\n");
+}
+
+void bench_report_accuracy(const char* suite, const char* name, const char* dataset, double accuracy,
+    double compared_accuracy, double tolerance) {
+    if (!bench_selected(suite, name)) {
+        return;
+    }
+
+    // Counted with the error bounds, so either kind of failure gives a non-zero exit status.
+    int passed = fabs(accuracy - compared_accuracy) <= tolerance;
+    if (!passed) {
+        num_failed_errors++;
+    }
+
+    if (num_accuracies == accuracies_capacity) {
+        int capacity = (accuracies_capacity == 0) ? 4 : 2 * accuracies_capacity;
+        AccuracyResult* grown = realloc(accuracies, capacity * sizeof(AccuracyResult));
+        if (grown == NULL) {
+            return;
+        }
+        accuracies = grown;
+        accuracies_capacity = capacity;
+    }
+    AccuracyResult* result = &accuracies[num_accuracies++];
+    snprintf(result->suite, sizeof(result->suite), "%s", suite);
+    snprintf(result->name, sizeof(result->name), "%s", name);
+    snprintf(result->dataset, sizeof(result->dataset), "%s", dataset);
+    result->accuracy = accuracy;
+    result->compared_accuracy = compared_accuracy;
+    result->tolerance = tolerance;
+    result->passed = passed;
+
+    printf("%-11s %-38s %-14s accuracy %7.3f%% vs %7.3f%%", suite, name, dataset, accuracy * 100,
+        compared_accuracy * 100);
+    if (!passed) {
+        printf("   FAILED, tolerance %g%%", tolerance * 100);
+    }
+    printf("\n");
+}
+
+static void print_json_string(FILE* file, const char* str) {
+    // Names contain no characters that need escaping other than quotes and backslashes.
+    fputc('"', file);
+    for (; *str != '\0'; str++) {
+        if (*str == '"' || *str == '\\') {
+            fputc('\\', file);
+        }
+        fputc(*str, file);
+    }
+    fputc('"', file);
+}
+
+static int write_json(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        return 0;
+    }
+
+    fprintf(file, "{\n  \"precision\": \"%s\",\n  \"simd\": \"%s\",\n  \"results\": [\n", SCALAR_NAME,
+        get_simd_kernels()->name);
+    for (int i=0; i < num_results; i++) {
+        const BenchResult* result = &results[i];
+        fprintf(file, "    {\"suite\": ");
+        print_json_string(file, result->suite);
+        fprintf(file, ", \"name\": ");
+        print_json_string(file, result->name);
+        fprintf(file, ", \"shape\": ");
+        print_json_string(file, result->shape);
+        fprintf(file, ", \"samples\": %d, \"iterations\": %ld, \"median_ns\": %.1f, \"p95_ns\": %.1f, "
+            "\"min_ns\": %.1f", result->samples, result->iterations, result->median_seconds * 1e9,
+            result->p95_seconds * 1e9, result->min_seconds * 1e9);
+
+        // Throughputs that do not apply are null, so that every result has the same fields.
+        if (result->flops > 0) {
+            fprintf(file, ", \"gflops\": %.4f", result->flops / result->median_seconds * 1e-9);
+        }
+        else {
+            fprintf(file, ", \"gflops\": null");
+        }
+        if (result->bytes > 0) {
+            fprintf(file, ", \"gbytes_per_s\": %.4f}", result->bytes / result->median_seconds * 1e-9);
+        }
+        else {
+            fprintf(file, ", \"gbytes_per_s\": null}");
+        }
+        fprintf(file, (i + 1 < num_results) ? ",\n" : "\n");
+    }
+    fprintf(file, "  ],\n  \"errors\": [\n");
+    for (int i=0; i < num_errors; i++) {
+        const ErrorResult* error = &errors[i];
+        fprintf(file, "    {\"suite\": ");
+        print_json_string(file, error->suite);
+        fprintf(file, ", \"name\": ");
+        print_json_string(file, error->name);
+        fprintf(file, ", \"range\": ");
+        print_json_string(file, error->range);
+        fprintf(file, ", \"max_ulp\": %.4f, \"max_abs\": %.6e", error->max_ulp, error->max_abs);
+
+        // Bounds that do not apply are null, like throughputs.
+        if (error->ulp_bound > 0) {
+            fprintf(file, ", \"ulp_bound\": %.4f", error->ulp_bound);
+        }
+        else {
+            fprintf(file, ", \"ulp_bound\": null");
+        }
+        if (error->abs_bound > 0) {
+            fprintf(file, ", \"abs_bound\": %.6e", error->abs_bound);
+        }
+        else {
+            fprintf(file, ", \"abs_bound\": null");
+        }
+        fprintf(file, ", \"passed\": %s}", error->passed ? "true" : "false");
+        fprintf(file, (i + 1 < num_errors) ? ",\n" : "\n");
+    }
+    fprintf(file, "  ],\n  \"accuracy\": [\n");
+    for (int i=0; i < num_accuracies; i++) {
+        const AccuracyResult* result = &accuracies[i];
+        fprintf(file, "    {\"suite\": ");
+        print_json_string(file, result->suite);
+        fprintf(file, ", \"name\": ");
+        print_json_string(file, result->name);
+        fprintf(file, ", \"dataset\": ");
+        print_json_string(file, result->dataset);
+        fprintf(file, ", \"accuracy\": %.6f, \"compared_accuracy\": %.6f, \"tolerance\": %.6f, \"passed\": %s}",
+            result->accuracy, result->compared_accuracy, result->tolerance, result->passed ? "true" : "false");
+        fprintf(file, (i + 1 < num_accuracies) ? ",\n" : "\n");
+    }
+    fprintf(file, "  ]\n}\n");
+
+    return fclose(file) == 0;
+}
+
+int load_bench_dataset(const char* dataset, Network* net, Matrix* input, Matrix* expected_output) {
+    char net_config_path[128], train_dataset_path[128];
+    snprintf(net_config_path, sizeof(net_config_path), "data/%s/net_config.json", dataset);
+    snprintf(train_dataset_path, sizeof(train_dataset_path), "data/%s/train.csv", dataset);
+
+    FILE* existence_check = fopen(net_config_path, "r");
+    if (existence_check == NULL) {
+        printf("Missing config for dataset %s, run the benchmarks from the root of the repository.\n", dataset);
+        return 0;
+    }
+    fclose(existence_check);
+
+    *net = build_network_from_config(net_config_path);
+    load_dataset_to_matrices(train_dataset_path, input, expected_output);
+    if (input->data == NULL) {
+        free_network(net);
+        return 0;
+    }
+    return 1;
+}
+
+Matrix random_matrix(int rows, int cols, double low, double high) {
+    Matrix matrix = create_matrix(rows, cols);
+    for (int row_count=0; row_count < rows; row_count++) {
+        for (int col_count=0; col_count < cols; col_count++) {
+            double uniform = (double)rand() / ((double)RAND_MAX + 1.0);
+            set_element(&matrix, row_count, col_count, low + (high - low) * uniform);
+        }
+    }
+    return matrix;
+}
+
+Matrix random_one_hot(int rows, int cols) {
+    Matrix matrix = create_matrix(rows, cols);
+    for (int col_count=0; col_count < cols; col_count++) {
+        set_element(&matrix, rand() % rows, col_count, 1.0);
+    }
+    return matrix;
+}
+
+int main(int argc, char* argv[]) {
+    // Usage: benchmark [--json PATH] [FILTER]
+    // Only benchmarks whose "suite/name" contains FILTER are run, and the results are written as JSON to PATH
+    // (bench_results.json by default) as well as being printed. Exits with status 1 if the results could not be
+    // written, if a measured approximation error exceeded its bound, or if an accuracy comparison failed.
+    const char* json_path = "bench_results.json";
+    for (int i=1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        }
+        else {
+            filter = argv[i];
+        }
+    }
+
+    srand(1); // Synthetic inputs are the same on every run
+    printf("Precision: %s, SIMD: %s\n", SCALAR_NAME, get_simd_kernels()->name);
+
+    bench_gemm_suite();
+    bench_elementwise_suite();
+    bench_network_suite();
+    bench_fast_math_suite();
+
+    if (!write_json(json_path)) {
+        printf("Error writing results to %s\n", json_path);
+        free(results);
+        free(errors);
+        free(accuracies);
+        return 1;
+    }
+    printf("Results written to %s\n", json_path);
+
+    free(results);
+    free(errors);
+    free(accuracies);
+    if (num_failed_errors > 0) {
+        printf("%d approximation error(s) exceeded their documented bound or tolerance\n", num_failed_errors);
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "nn/neural_network.h"
+#include "maths/matrix.h"
+
+// Names of the bundled datasets, whose network and data shapes are benchmarked by each suite.
+extern const char* bench_datasets[];
+extern const int num_bench_datasets;
+
+typedef void (*BenchFunc)(void* arg);
+
+// Times fn(arg), reports the result, and records it for the JSON output. The function is first run untimed to
+// warm up caches and branch predictors, then timed over repeated samples of enough calls each to be measured
+// accurately, and the median, 95th percentile and minimum time per call are reported. flops and bytes are the
+// floating-point operations performed and bytes read and written per call, used to report GFLOP/s and GB/s;
+// either may be 0 if it does not apply. Benchmarks whose "suite/name" does not match the filter given on the
+// command line are skipped.
+void bench_run(const char* suite, const char* name, const char* shape, BenchFunc fn, void* arg, double flops,
+    double bytes);
+
+// Reports the largest error of an approximation measured over a range of inputs, and records it for the JSON
+// output: max_ulp in units in the last place of the exact result (as a Scalar), and max_abs as an absolute
+// error. The errors are checked against the documented bounds ulp_bound and abs_bound, either of which may be 0
+// if the approximation is not bounded in that measure, and the benchmark exits with a non-zero status if any
+// error exceeds its bound. Errors are skipped, like benchmarks, if their "suite/name" does not match the filter.
+void bench_report_error(const char* suite, const char* name, const char* range, double max_ulp, double max_abs,
+    double ulp_bound, double abs_bound);
+
+// Reports the test accuracy of the same trained network evaluated two ways, such as with exact and fast maths,
+// and records it for the JSON output. The benchmark exits with a non-zero status if the accuracies differ by
+// more than tolerance (as a fraction of samples). Skipped, like benchmarks, if "suite/name" does not match the
+// filter.
+void bench_report_accuracy(const char* suite, const char* name, const char* dataset, double accuracy,
+    double compared_accuracy, double tolerance);
+
+// Returns 1 if the benchmark or error "suite/name" matches the filter given on the command line, so is run.
+int bench_selected(const char* suite, const char* name);
+
+// Builds the network of a bundled dataset from its config and loads its training data. Returns 0 if either
+// could not be loaded, and 1 otherwise.
+int load_bench_dataset(const char* dataset, Network* net, Matrix* input, Matrix* expected_output);
+
+// Returns a matrix with elements drawn uniformly from [low, high).
+Matrix random_matrix(int rows, int cols, double low, double high);
+
+// Returns a matrix of one-hot columns, each with a randomly chosen row set to 1.
+Matrix random_one_hot(int rows, int cols);
+
+// Suites, each defined in its own file.
+void bench_gemm_suite();
+void bench_elementwise_suite();
+void bench_network_suite();
+void bench_fast_math_suite();
+
+#endif
\ No newline at end of file
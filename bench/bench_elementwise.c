@@ -0,0 +1,253 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "nn/neural_network.h"
+#include "maths/matrix.h"
+#include "maths/activation.h"
+#include "maths/softmax.h"
+#include "maths/loss.h"
+
+typedef struct ElementwiseArgs {
+    Matrix* result;
+    const Matrix* a;
+    const Matrix* b;
+    Scalar (*func)(Scalar);
+    const ActivationFunc* activation;
+    const LossFunc* loss_func;
+    volatile double sink; // Loss values are stored here so that their calculation is not optimised out
+} ElementwiseArgs;
+
+static void run_addition(void* arg) {
+    ElementwiseArgs* args = arg;
+    matrix_addition_into(args->result, args->a, args->b);
+}
+
+static void run_allocating_addition(void* arg) {
+    // The allocating form, which creates and frees its result on every call.
+    ElementwiseArgs* args = arg;
+    Matrix result = matrix_addition(args->a, args->b);
+    free_matrix(&result);
+}
+
+static void run_create_free(void* arg) {
+    ElementwiseArgs* args = arg;
+    Matrix matrix = create_matrix(args->a->rows, args->a->cols);
+    free_matrix(&matrix);
+}
+
+static void run_create_uninitialised_free(void* arg) {
+    ElementwiseArgs* args = arg;
+    Matrix matrix = create_uninitialised_matrix(args->a->rows, args->a->cols, MATRIX_ROW_MAJOR);
+    free_matrix(&matrix);
+}
+
+static void run_hadamard(void* arg) {
+    ElementwiseArgs* args = arg;
+    hadamard_product_into(args->result, args->a, args->b);
+}
+
+static void run_scale(void* arg) {
+    ElementwiseArgs* args = arg;
+    matrix_scalar_multiplication_into(args->result, args->a, 0.5);
+}
+
+static void run_axpy(void* arg) {
+    // Alternates the sign of alpha, so that the result stays bounded however many times it is run.
+    ElementwiseArgs* args = arg;
+    static int sign = 1;
+    sign = -sign;
+    matrix_axpy(args->result, sign * 0.5, args->a);
+}
+
+static void run_broadcast(void* arg) {
+    ElementwiseArgs* args = arg;
+    matrix_broadcast_addition_into(args->result, args->a, args->b);
+}
+
+static void run_apply_func(void* arg) {
+    ElementwiseArgs* args = arg;
+    apply_func_into(args->result, args->a, args->func);
+}
+
+static void run_activation(void* arg) {
+    ElementwiseArgs* args = arg;
+    for (int row_count=0; row_count < args->a->rows; row_count++) {
+        args->activation->apply_ptr(&args->a->data[row_count * args->a->stride],
+            &args->result->data[row_count * args->result->stride], args->a->cols);
+    }
+}
+
+static void run_activation_backward(void* arg) {
+    // a holds the activations, and b the derivative of the loss with respect to them.
+    ElementwiseArgs* args = arg;
+    for (int row_count=0; row_count < args->a->rows; row_count++) {
+        args->activation->backward_ptr(&args->a->data[row_count * args->a->stride],
+            &args->b->data[row_count * args->b->stride], &args->result->data[row_count * args->result->stride],
+            args->a->cols);
+    }
+}
+
+static void run_softmax(void* arg) {
+    ElementwiseArgs* args = arg;
+    softmax_func_into(args->result, args->a);
+}
+
+static void run_softmax_derivative(void* arg) {
+    ElementwiseArgs* args = arg;
+    softmax_derivative_into(args->result, args->a, args->b);
+}
+
+static void run_loss(void* arg) {
+    ElementwiseArgs* args = arg;
+    args->sink = args->loss_func->func_ptr(args->a, args->b);
+}
+
+static void run_loss_derivative(void* arg) {
+    ElementwiseArgs* args = arg;
+    args->loss_func->derivative_into_ptr(args->result, args->a, args->b);
+}
+
+static void run_softmax_cce_gradient(void* arg) {
+    ElementwiseArgs* args = arg;
+    softmax_cross_entropy_gradient_into(args->result, args->a, args->b, MATH_EXACT);
+}
+
+static void run_sigmoid_bce_gradient(void* arg) {
+    ElementwiseArgs* args = arg;
+    sigmoid_binary_cross_entropy_gradient_into(args->result, args->a, args->b, MATH_EXACT);
+}
+
+static void bench_matrix_ops(const char* label, int rows, int cols) {
+    // Element-wise operations on matrices the size of a hidden layer's outputs over a batch.
+    Matrix a = random_matrix(rows, cols, -4.0, 4.0);
+    Matrix b = random_matrix(rows, cols, -4.0, 4.0);
+    Matrix bias = random_matrix(rows, 1, -1.0, 1.0);
+    Matrix result = create_matrix(rows, cols);
+    ElementwiseArgs args = {&result, &a, &b, NULL, NULL, NULL, 0.0};
+
+    char shape[48], name[64];
+    sprintf(shape, "%dx%d", rows, cols);
+    double n = (double)rows * cols, bytes = n * sizeof(Scalar);
+
+    sprintf(name, "%s addition", label);
+    bench_run("elementwise", name, shape, run_addition, &args, n, 3 * bytes);
+    sprintf(name, "%s allocating addition", label);
+    bench_run("elementwise", name, shape, run_allocating_addition, &args, n, 3 * bytes);
+    sprintf(name, "%s hadamard", label);
+    bench_run("elementwise", name, shape, run_hadamard, &args, n, 3 * bytes);
+    sprintf(name, "%s scale", label);
+    bench_run("elementwise", name, shape, run_scale, &args, n, 2 * bytes);
+    sprintf(name, "%s axpy", label);
+    bench_run("elementwise", name, shape, run_axpy, &args, 2 * n, 3 * bytes);
+
+    // Creating and freeing a matrix of the same size, which with NN_MATRIX_POOL=1 reuses one pooled buffer.
+    sprintf(name, "%s create_matrix", label);
+    bench_run("alloc", name, shape, run_create_free, &args, 0, bytes);
+    sprintf(name, "%s create_uninitialised_matrix", label);
+    bench_run("alloc", name, shape, run_create_uninitialised_free, &args, 0, 0);
+
+    args.b = &bias;
+    sprintf(name, "%s broadcast addition", label);
+    bench_run("elementwise", name, shape, run_broadcast, &args, n, 2 * bytes);
+
+    // Activation functions and their derivatives, both applied one element at a time through the scalar
+    // functions, and an array at a time through the kernels used in training. The backward kernels calculate
+    // the derivative from the activations, so are given them as a, with b standing in for dL_da.
+    const char* func_names[] = {"sigmoid", "tanh", "ReLu"};
+    const ActivationFunc* activations[] = {&sigmoid, &tanh_custom, &ReLu};
+    Matrix activated = create_matrix(rows, cols);
+    for (int i=0; i < 3; i++) {
+        args.a = &a;
+        args.activation = activations[i];
+        args.func = activations[i]->func_ptr;
+        sprintf(name, "%s %s per element", label, func_names[i]);
+        bench_run("activation", name, shape, run_apply_func, &args, 0, 2 * bytes);
+        args.func = activations[i]->derivative_ptr;
+        sprintf(name, "%s %s' per element", label, func_names[i]);
+        bench_run("activation", name, shape, run_apply_func, &args, 0, 2 * bytes);
+
+        sprintf(name, "%s %s", label, func_names[i]);
+        bench_run("activation", name, shape, run_activation, &args, 0, 2 * bytes);
+
+        apply_func_into(&activated, &a, activations[i]->func_ptr);
+        args.a = &activated;
+        args.b = &b;
+        sprintf(name, "%s %s backward", label, func_names[i]);
+        bench_run("activation", name, shape, run_activation_backward, &args, 0, 3 * bytes);
+    }
+    free_matrix(&activated);
+
+    free_matrix(&a);
+    free_matrix(&b);
+    free_matrix(&bias);
+    free_matrix(&result);
+}
+
+static void bench_output_ops(const char* label, int rows, int cols) {
+    // Softmax and the loss functions, on matrices the size of the output layer's outputs over a batch. The
+    // predictions are softmax outputs and the expected outputs one-hot, so every loss has valid inputs.
+    Matrix z = random_matrix(rows, cols, -4.0, 4.0);
+    Matrix y_pred = create_matrix(rows, cols);
+    softmax_func_into(&y_pred, &z);
+    Matrix y = random_one_hot(rows, cols);
+    Matrix loss_deriv = random_matrix(rows, cols, -1.0, 1.0);
+    Matrix result = create_matrix(rows, cols);
+
+    char shape[48], name[64];
+    sprintf(shape, "%dx%d", rows, cols);
+    double bytes = (double)rows * cols * sizeof(Scalar);
+
+    ElementwiseArgs args = {&result, &z, NULL, NULL, NULL, NULL, 0.0};
+    sprintf(name, "%s softmax", label);
+    bench_run("softmax", name, shape, run_softmax, &args, 0, 2 * bytes);
+
+    args.a = &y_pred;
+    args.b = &loss_deriv;
+    sprintf(name, "%s softmax derivative", label);
+    bench_run("softmax", name, shape, run_softmax_derivative, &args, 0, 3 * bytes);
+
+    const char* loss_names[] = {"MSE", "MAE", "BCE", "CCE"};
+    const LossFunc* loss_funcs[] = {&MSE, &MAE, &BCE, &CCE};
+    args.a = &y;
+    args.b = &y_pred;
+    for (int i=0; i < 4; i++) {
+        args.loss_func = loss_funcs[i];
+        sprintf(name, "%s %s", label, loss_names[i]);
+        bench_run("loss", name, shape, run_loss, &args, 0, 2 * bytes);
+        sprintf(name, "%s %s derivative", label, loss_names[i]);
+        bench_run("loss", name, shape, run_loss_derivative, &args, 0, 3 * bytes);
+    }
+
+    sprintf(name, "%s softmax+CCE gradient", label);
+    bench_run("loss", name, shape, run_softmax_cce_gradient, &args, 0, 3 * bytes);
+    sprintf(name, "%s sigmoid+BCE gradient", label);
+    bench_run("loss", name, shape, run_sigmoid_bce_gradient, &args, 0, 3 * bytes);
+
+    free_matrix(&z);
+    free_matrix(&y_pred);
+    free_matrix(&y);
+    free_matrix(&loss_deriv);
+    free_matrix(&result);
+}
+
+void bench_elementwise_suite() {
+    // Each bundled network's first hidden layer and output layer, over its whole training set.
+    for (int d=0; d < num_bench_datasets; d++) {
+        Network net;
+        Matrix input, expected_output;
+        if (!load_bench_dataset(bench_datasets[d], &net, &input, &expected_output)) {
+            continue;
+        }
+
+        bench_matrix_ops(bench_datasets[d], net.layers[0].num_nodes, input.cols);
+        bench_output_ops(bench_datasets[d], net.layers[net.num_layers-1].num_nodes, input.cols);
+
+        free_matrix(&input);
+        free_matrix(&expected_output);
+        free_network(&net);
+    }
+
+    // Larger synthetic sizes, which no longer fit in the L2 cache.
+    bench_matrix_ops("synthetic", 1024, 1024);
+    bench_output_ops("synthetic", 10, 65536);
+}
\ No newline at end of file
@@ -0,0 +1,240 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <float.h>
+#include <tgmath.h> // exp, log and tanh resolve to the variants for the Scalar type
+#include "bench.h"
+#include "maths/fast_math.h"
+#include "maths/simd.h"
+#include "maths/activation.h"
+#include "maths/softmax.h"
+#include "maths/matrix.h"
+#include "maths/loss.h"
+#include "nn/neural_network.h"
+#include "nn/training.h"
+#include "nn/evaluation.h"
+#include "nn/optimizer.h"
+#include "nn/lr_schedule.h"
+#include "io/dataset_loader.h"
+#include "io/train_config_loader.h"
+
+#define ERROR_SAMPLES (1 << 20)
+
+// The error bounds documented in fast_math.h. Sigmoid and tanh are only bounded in absolute error, of 2 ulp of
+// 1: near 0 their relative error is far larger (around 3600 ulp for fast_tanh in double, 1200 in float).
+#define EXP_ULP_BOUND 2.0
+#define LOG_ULP_BOUND 3.0
+// Largest difference in test accuracy, as a fraction of samples, allowed between evaluating the same trained
+// network with MATH_EXACT and with MATH_FAST. For iris, whose test set has 36 samples, this means no prediction
+// may change.
+#define ACCURACY_TOLERANCE 0.01
+
+#define SIGMOID_TANH_ABS_BOUND (2.0 * ((sizeof(Scalar) == 4) ? FLT_EPSILON : DBL_EPSILON))
+
+typedef void (*ArrayFunc)(const Scalar* in, Scalar* out, int n);
+
+typedef struct FastMathArgs {
+    const Scalar* in;
+    Scalar* out;
+    int n;
+    ArrayFunc func;
+    Matrix* result;
+    const Matrix* z;
+} FastMathArgs;
+
+static void exact_exp(const Scalar* in, Scalar* out, int n) {
+    for (int i=0; i < n; i++) {
+        out[i] = exp(in[i]);
+    }
+}
+
+static void exact_log(const Scalar* in, Scalar* out, int n) {
+    for (int i=0; i < n; i++) {
+        out[i] = log(in[i]);
+    }
+}
+
+static void run_array_func(void* arg) {
+    FastMathArgs* args = arg;
+    args->func(args->in, args->out, args->n);
+}
+
+static void run_softmax(void* arg) {
+    FastMathArgs* args = arg;
+    softmax_func_into(args->result, args->z);
+}
+
+static void run_softmax_fast(void* arg) {
+    FastMathArgs* args = arg;
+    softmax_fast_func_into(args->result, args->z);
+}
+
+static double reference_sigmoid(double x) {
+    return 1 / (1 + exp(-x));
+}
+
+static void measure_error(const char* name, ArrayFunc func, double (*reference)(double), double low, double high,
+    int logarithmic, double ulp_bound, double abs_bound) {
+    // Compares the approximation, as run by the selected SIMD kernels, against the C library in double
+    // precision over evenly spaced inputs in [low, high], or inputs evenly spaced in their logarithm, and checks
+    // the largest errors against the given bounds (0 for none).
+    if (!bench_selected("fast_math", name)) {
+        return;
+    }
+
+    Scalar* in = malloc(ERROR_SAMPLES * sizeof(Scalar));
+    Scalar* out = malloc(ERROR_SAMPLES * sizeof(Scalar));
+    if (in == NULL || out == NULL) {
+        free(in);
+        free(out);
+        return;
+    }
+    for (int i=0; i < ERROR_SAMPLES; i++) {
+        double t = (double)i / (ERROR_SAMPLES - 1);
+        // Interpolated in log space, as high / low overflows for the widest ranges.
+        in[i] = logarithmic ? exp(log(low) + (log(high) - log(low)) * t) : low + (high - low) * t;
+    }
+    func(in, out, ERROR_SAMPLES);
+
+    double max_ulp = 0.0, max_abs = 0.0;
+    for (int i=0; i < ERROR_SAMPLES; i++) {
+        double expected = reference((double)in[i]);
+        Scalar rounded = (Scalar)expected;
+        if (!isfinite(rounded) || rounded == 0) {
+            continue;
+        }
+
+        // The distance from the exact result to the next Scalar away from zero.
+        double ulp = (double)nextafter(fabs(rounded), (Scalar)INFINITY) - (double)fabs(rounded);
+        double error = fabs((double)out[i] - expected);
+        max_ulp = (error / ulp > max_ulp) ? error / ulp : max_ulp;
+        max_abs = (error > max_abs) ? error : max_abs;
+    }
+
+    char range[48];
+    sprintf(range, "[%g, %g]", low, high);
+    bench_report_error("fast_math", name, range, max_ulp, max_abs, ulp_bound, abs_bound);
+
+    free(in);
+    free(out);
+}
+
+static void compare_test_accuracy(const char* dataset) {
+    // Trains the network of a bundled dataset as its train_config.json describes, with exact maths, then
+    // evaluates the same weights on its test dataset with MATH_EXACT and with MATH_FAST.
+    char name[64];
+    sprintf(name, "%s test accuracy", dataset);
+    if (!bench_selected("fast_math", name)) {
+        return;
+    }
+
+    Network net;
+    Matrix train_input, train_output;
+    if (!load_bench_dataset(dataset, &net, &train_input, &train_output)) {
+        return;
+    }
+
+    char train_config_path[128], test_dataset_path[128];
+    snprintf(train_config_path, sizeof(train_config_path), "data/%s/train_config.json", dataset);
+    snprintf(test_dataset_path, sizeof(test_dataset_path), "data/%s/test.csv", dataset);
+
+    LearningRateSchedule lr_schedule;
+    Optimizer optimizer;
+    TrainingOptions options;
+    const LossFunc* loss_func;
+    int num_epoch;
+    extract_training_parameters(train_config_path, &loss_func, &num_epoch, &lr_schedule, &optimizer, &options);
+
+    net.math_accuracy = MATH_EXACT;
+    TrainingMonitor monitor = {NULL, NULL, 0, NULL, TELEMETRY_JSON};
+    training_loop(&net, num_epoch, &train_input, &train_output, loss_func, &lr_schedule, &optimizer, &options,
+        &monitor);
+
+    Matrix test_input, test_output;
+    load_dataset_to_matrices(test_dataset_path, &test_input, &test_output);
+    if (test_input.data != NULL) {
+        Matrix exact_output = predict(&net, &test_input);
+        net.math_accuracy = MATH_FAST;
+        Matrix fast_output = predict(&net, &test_input);
+
+        bench_report_accuracy("fast_math", name, "test.csv", calc_accuracy(&exact_output, &test_output),
+            calc_accuracy(&fast_output, &test_output), ACCURACY_TOLERANCE);
+
+        free_matrix(&exact_output);
+        free_matrix(&fast_output);
+    }
+
+    free_matrix(&test_input);
+    free_matrix(&test_output);
+    free_matrix(&train_input);
+    free_matrix(&train_output);
+    free_network(&net);
+}
+
+static void bench_array_funcs(int n) {
+    // Each function exactly (with the C library) and approximately, on inputs where neither over or underflows.
+    const SimdKernels* kernels = get_simd_kernels();
+    Matrix exp_in = random_matrix(1, n, -20.0, 20.0);
+    Matrix log_in = random_matrix(1, n, 1e-6, 100.0);
+    Matrix out = create_matrix(1, n);
+
+    char shape[48], name[64];
+    sprintf(shape, "%d", n);
+    double bytes = 2.0 * n * sizeof(Scalar);
+
+    const char* names[] = {"exp", "log", "sigmoid", "tanh"};
+    const Matrix* inputs[] = {&exp_in, &log_in, &exp_in, &exp_in};
+    ArrayFunc exact_funcs[] = {exact_exp, exact_log, sigmoid_apply, tanh_apply};
+    ArrayFunc fast_funcs[] = {kernels->fast_exp, kernels->fast_log, kernels->fast_sigmoid, kernels->fast_tanh};
+    for (int i=0; i < 4; i++) {
+        FastMathArgs args = {inputs[i]->data, out.data, n, exact_funcs[i], NULL, NULL};
+        sprintf(name, "%s exact", names[i]);
+        bench_run("fast_math", name, shape, run_array_func, &args, 0, bytes);
+
+        args.func = fast_funcs[i];
+        sprintf(name, "%s fast", names[i]);
+        bench_run("fast_math", name, shape, run_array_func, &args, 0, bytes);
+    }
+
+    free_matrix(&exp_in);
+    free_matrix(&log_in);
+    free_matrix(&out);
+}
+
+static void bench_softmax(int rows, int cols) {
+    Matrix z = random_matrix(rows, cols, -4.0, 4.0);
+    Matrix result = create_matrix(rows, cols);
+
+    char shape[48];
+    sprintf(shape, "%dx%d", rows, cols);
+    double bytes = 2.0 * rows * cols * sizeof(Scalar);
+
+    FastMathArgs args = {NULL, NULL, 0, NULL, &result, &z};
+    bench_run("fast_math", "softmax exact", shape, run_softmax, &args, 0, bytes);
+    bench_run("fast_math", "softmax fast", shape, run_softmax_fast, &args, 0, bytes);
+
+    free_matrix(&z);
+    free_matrix(&result);
+}
+
+void bench_fast_math_suite() {
+    // The error bounds given in fast_math.h, measured over each function's supported range, or the range where
+    // the result is not within an ulp of its limits for sigmoid and tanh.
+    const SimdKernels* kernels = get_simd_kernels();
+    int single = (sizeof(Scalar) == 4);
+    measure_error("exp error", kernels->fast_exp, exp, single ? -87.0 : -708.0, single ? 88.0 : 709.0, 0,
+        EXP_ULP_BOUND, 0);
+    measure_error("log error", kernels->fast_log, log, single ? 1e-37 : 1e-307, single ? 1e38 : 1e308, 1,
+        LOG_ULP_BOUND, 0);
+    measure_error("log error near 1", kernels->fast_log, log, 0.5, 2.0, 0, LOG_ULP_BOUND, 0);
+    measure_error("sigmoid error", kernels->fast_sigmoid, reference_sigmoid, -40.0, 40.0, 0, 0,
+        SIGMOID_TANH_ABS_BOUND);
+    measure_error("tanh error", kernels->fast_tanh, tanh, -20.0, 20.0, 0, 0, SIGMOID_TANH_ABS_BOUND);
+
+    // Whether the errors above change the predictions of trained networks.
+    compare_test_accuracy("iris");
+    compare_test_accuracy("iot_intrusion");
+
+    bench_array_funcs(1024);
+    bench_array_funcs(1 << 20);
+    bench_softmax(10, 65536);
+}
\ No newline at end of file
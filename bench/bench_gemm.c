@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "nn/neural_network.h"
+#include "maths/matrix.h"
+
+typedef struct GemmArgs {
+    Matrix* result;
+    const Matrix* a;
+    int transpose_a;
+    const Matrix* b;
+    int transpose_b;
+} GemmArgs;
+
+static void naive_multiplication_into(void* arg) {
+    // The original i-j-k implementation of matrix_multiplication, kept as the baseline being compared against.
+    // Transposed operands are indexed in place, so neither version pays for materialising a transpose.
+    GemmArgs* args = arg;
+    int inner = args->transpose_a ? args->a->rows : args->a->cols;
+    for (int i=0; i < args->result->rows; i++) {
+        for (int j=0; j < args->result->cols; j++) {
+            double ele = 0;
+            for (int k=0; k < inner; k++) {
+                Scalar a_ik = args->transpose_a ? get_element(args->a, k, i) : get_element(args->a, i, k);
+                Scalar b_kj = args->transpose_b ? get_element(args->b, j, k) : get_element(args->b, k, j);
+                ele += a_ik * b_kj;
+            }
+            set_element(args->result, i, j, ele);
+        }
+    }
+}
+
+static void gemm_multiplication_into(void* arg) {
+    GemmArgs* args = arg;
+    matrix_multiplication_transposed_into(args->result, args->a, args->transpose_a, args->b, args->transpose_b);
+}
+
+static void bench_shape(const char* label, int m, int k, int n, int transpose_a, int transpose_b) {
+    // Times op(A) * op(B), where op(A) is m x k and op(B) is k x n, with both the blocked kernel and the naive
+    // reference.
+    Matrix a = transpose_a ? random_matrix(k, m, -0.5, 0.5) : random_matrix(m, k, -0.5, 0.5);
+    Matrix b = transpose_b ? random_matrix(n, k, -0.5, 0.5) : random_matrix(k, n, -0.5, 0.5);
+    Matrix expected = create_matrix(m, n);
+    Matrix actual = create_matrix(m, n);
+
+    // Checking the blocked kernel against the reference before timing it. The kernel accumulates in Scalar, so
+    // its rounding errors grow with the length of the inner dimension.
+    GemmArgs naive_args = {&expected, &a, transpose_a, &b, transpose_b};
+    GemmArgs gemm_args = {&actual, &a, transpose_a, &b, transpose_b};
+    naive_multiplication_into(&naive_args);
+    gemm_multiplication_into(&gemm_args);
+    double max_error = 0.0;
+    for (int row_count=0; row_count < m; row_count++) {
+        for (int col_count=0; col_count < n; col_count++) {
+            double error = get_element(&expected, row_count, col_count) - get_element(&actual, row_count, col_count);
+            error = (error < 0) ? -error : error;
+            if (error > max_error) {
+                max_error = error;
+            }
+        }
+    }
+    double tolerance = k * ((sizeof(Scalar) == sizeof(float)) ? 1e-6 : 1e-14);
+    if (max_error > tolerance) {
+        printf("WARNING: %s differs from the reference by up to %.2e\n", label, max_error);
+    }
+
+    char shape[48], name[64];
+    sprintf(shape, "%dx%dx%d", m, k, n);
+    double flops = 2.0 * m * n * k;
+    double bytes = ((double)m * k + (double)k * n + (double)m * n) * sizeof(Scalar);
+
+    // The reference is only timed on products small enough to take well under a second.
+    if (flops <= 1e8) {
+        sprintf(name, "%s naive", label);
+        bench_run("gemm", name, shape, naive_multiplication_into, &naive_args, flops, bytes);
+    }
+    sprintf(name, "%s", label);
+    bench_run("gemm", name, shape, gemm_multiplication_into, &gemm_args, flops, bytes);
+
+    free_matrix(&a);
+    free_matrix(&b);
+    free_matrix(&expected);
+    free_matrix(&actual);
+}
+
+void bench_gemm_suite() {
+    // Benchmarks the GEMM kernel against the naive reference on every product performed while training the
+    // bundled networks: the forward pass (W * X), the weight gradient (dL_dz * a^T) and the propagated
+    // gradient (W^T * dL_dz), with the number of samples in each training set as the batch size.
+    for (int d=0; d < num_bench_datasets; d++) {
+        Network net;
+        Matrix input, expected_output;
+        if (!load_bench_dataset(bench_datasets[d], &net, &input, &expected_output)) {
+            continue;
+        }
+        int samples = input.cols;
+        free_matrix(&input);
+        free_matrix(&expected_output);
+
+        for (int i=0; i < net.num_layers; i++) {
+            int outputs = net.layers[i].weights.rows;
+            int inputs = net.layers[i].weights.cols;
+            char label[64];
+
+            sprintf(label, "%s layer %d forward", bench_datasets[d], i);
+            bench_shape(label, outputs, inputs, samples, 0, 0);
+            sprintf(label, "%s layer %d dL_dw", bench_datasets[d], i);
+            bench_shape(label, outputs, samples, inputs, 0, 1);
+            if (i > 0) {
+                sprintf(label, "%s layer %d dL_da", bench_datasets[d], i);
+                bench_shape(label, inputs, outputs, samples, 1, 0);
+            }
+        }
+
+        free_network(&net);
+    }
+
+    bench_shape("square", 256, 256, 256, 0, 0);
+    bench_shape("square", 512, 512, 512, 0, 0);
+    bench_shape("square transposed", 512, 512, 512, 1, 1);
+}
\ No newline at end of file
@@ -0,0 +1,244 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "bench.h"
+#include "io/dataset_loader.h"
+#include "io/dataset_cache.h"
+#include "nn/neural_network.h"
+#include "nn/training.h"
+#include "nn/optimizer.h"
+#include "nn/weight_init.h"
+#include "maths/matrix.h"
+#include "maths/activation.h"
+#include "maths/softmax.h"
+#include "maths/loss.h"
+
+typedef struct NetworkArgs {
+    Network* net;
+    const Matrix* input;
+    const Matrix* expected_output;
+    const LossFunc* loss_func;
+    const Optimizer* optimizer;
+    int step;
+} NetworkArgs;
+
+typedef struct LoadArgs {
+    const char* path;
+    int cached;
+} LoadArgs;
+
+static void run_forward_pass(void* arg) {
+    NetworkArgs* args = arg;
+    forward_pass_into_layers(args->net, args->input);
+}
+
+static void run_train_step(void* arg) {
+    // The learning rate is 0, so the parameters (and so the time taken by each step) do not change between
+    // runs, while every part of the update is still performed.
+    NetworkArgs* args = arg;
+    args->step++;
+    train_step(args->net, args->input, args->expected_output, args->loss_func, args->optimizer, 0.0, args->step);
+}
+
+static void run_load_dataset(void* arg) {
+    LoadArgs* args = arg;
+    Matrix input, expected_output;
+    if (args->cached) {
+        load_dataset_cache(args->path, &input, &expected_output);
+    }
+    else {
+        parse_csv_dataset(args->path, &input, &expected_output);
+    }
+    free_matrix(&input);
+    free_matrix(&expected_output);
+}
+
+static double forward_flops(const Network* net, int batch_size) {
+    // Each layer multiplies its weights by a batch of inputs.
+    double flops = 0.0;
+    for (int i=0; i < net->num_layers; i++) {
+        flops += 2.0 * net->layers[i].weights.rows * net->layers[i].weights.cols * batch_size;
+    }
+    return flops;
+}
+
+static double train_step_flops(const Network* net, int batch_size) {
+    // On top of the forward pass, every layer computes its weight gradient, and every layer but the first
+    // propagates the gradient to the layer before it, each a product of the same size as the forward one.
+    double per_layer = forward_flops(net, batch_size);
+    double first_layer = 2.0 * net->layers[0].weights.rows * net->layers[0].weights.cols * batch_size;
+    return 3 * per_layer - first_layer;
+}
+
+static Matrix copy_with_layout(const Matrix* matrix, MatrixLayout layout) {
+    Matrix copy = create_matrix_with_layout(matrix->rows, matrix->cols, layout);
+    copy_matrix_into(&copy, matrix);
+    return copy;
+}
+
+static void bench_network(const char* label, Network* net, const Matrix* input, const Matrix* expected_output,
+    const LossFunc* loss_func, int batch_size) {
+    // Times a forward pass and a training step with each optimizer over one batch of the dataset.
+    Matrix input_batch = matrix_column_view(input, 0, batch_size);
+    Matrix expected_batch = matrix_column_view(expected_output, 0, batch_size);
+    reserve_workspace(net, batch_size);
+
+    char shape[48], name[64];
+    sprintf(shape, "batch %d", batch_size);
+
+    NetworkArgs args = {net, &input_batch, &expected_batch, loss_func, NULL, 0};
+    sprintf(name, "%s forward_pass", label);
+    bench_run("network", name, shape, run_forward_pass, &args, forward_flops(net, batch_size), 0);
+
+    MathAccuracy accuracy = net->math_accuracy;
+    net->math_accuracy = MATH_FAST;
+    sprintf(name, "%s forward_pass fast", label);
+    bench_run("network", name, shape, run_forward_pass, &args, forward_flops(net, batch_size), 0);
+    net->math_accuracy = accuracy;
+
+    const char* optimizer_names[] = {"SGD", "momentum", "Adam"};
+    Optimizer optimizers[3] = {{SGD}, {MOMENTUM}, {ADAM}};
+    optimizers[1].param.momentum.momentum = 0.9;
+    optimizers[2].param.adam = (AdamParams){0.9, 0.999, 1e-8};
+    for (int i=0; i < 3; i++) {
+        if (!init_optimizer_state(net, &optimizers[i])) {
+            continue;
+        }
+        args.optimizer = &optimizers[i];
+        args.step = 0;
+        sprintf(name, "%s train_step %s", label, optimizer_names[i]);
+        bench_run("network", name, shape, run_train_step, &args, train_step_flops(net, batch_size), 0);
+    }
+
+    // The same batch stored row-major, for comparison with the column-major layout datasets are loaded in.
+    Matrix row_major_input = copy_with_layout(&input_batch, MATRIX_ROW_MAJOR);
+    Matrix row_major_expected = copy_with_layout(&expected_batch, MATRIX_ROW_MAJOR);
+    args.input = &row_major_input;
+    args.expected_output = &row_major_expected;
+    sprintf(name, "%s forward_pass row-major", label);
+    bench_run("network", name, shape, run_forward_pass, &args, forward_flops(net, batch_size), 0);
+
+    Optimizer sgd = {SGD};
+    args.optimizer = &sgd;
+    args.step = 0;
+    sprintf(name, "%s train_step SGD row-major", label);
+    bench_run("network", name, shape, run_train_step, &args, train_step_flops(net, batch_size), 0);
+    free_matrix(&row_major_input);
+    free_matrix(&row_major_expected);
+
+    // The same step in lean memory mode, on its own and with every other layer's output recomputed during
+    // backpropagation, to show the cost of each against the memory it saves.
+    args.input = &input_batch;
+    args.expected_output = &expected_batch;
+    const char* memory_names[] = {"lean", "lean ckpt"};
+    int checkpoint_intervals[] = {0, 2};
+    for (int i=0; i < 2; i++) {
+        set_workspace_memory(net, 1, checkpoint_intervals[i]);
+        args.step = 0;
+        sprintf(name, "%s train_step SGD %s", label, memory_names[i]);
+        bench_run("network", name, shape, run_train_step, &args, train_step_flops(net, batch_size), 0);
+    }
+    set_workspace_memory(net, 0, 0);
+}
+
+static void bench_load(const char* label, const char* path) {
+    // Times loading a dataset both by parsing the .csv and by mapping its cache, with the size of the .csv as
+    // the bytes processed.
+    struct stat source_info;
+    if (stat(path, &source_info) != 0 || !convert_dataset_to_cache(path)) {
+        return;
+    }
+    double bytes = (double)source_info.st_size;
+    char shape[48], name[64];
+    sprintf(shape, "%.1f KiB", bytes / 1024.0);
+
+    LoadArgs args = {path, 0};
+    sprintf(name, "%s parse csv", label);
+    bench_run("load", name, shape, run_load_dataset, &args, 0, bytes);
+
+    args.cached = 1;
+    sprintf(name, "%s map cache", label);
+    bench_run("load", name, shape, run_load_dataset, &args, 0, bytes);
+}
+
+static int write_synthetic_csv(const char* path, int rows, int inputs, int outputs) {
+    // Writes a dataset of random inputs and one-hot outputs in the format of the bundled datasets.
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        return 0;
+    }
+    fprintf(file, "# INPUTS: %d, OUTPUTS: %d\n", inputs, outputs);
+    for (int col=0; col < inputs + outputs; col++) {
+        fprintf(file, (col + 1 < inputs + outputs) ? "c%d," : "c%d\n", col);
+    }
+    for (int row=0; row < rows; row++) {
+        for (int col=0; col < inputs; col++) {
+            fprintf(file, "%.17g,", 8.0 * rand() / RAND_MAX - 4.0);
+        }
+        int label = rand() % outputs;
+        for (int col=0; col < outputs; col++) {
+            fprintf(file, (col + 1 < outputs) ? "%d," : "%d\n", col == label);
+        }
+    }
+    return fclose(file) == 0;
+}
+
+void bench_network_suite() {
+    // Each bundled network over a batch of its training set, of the whole set for the small datasets and of
+    // 256 samples (the batch size it is trained with) for iot_intrusion.
+    for (int d=0; d < num_bench_datasets; d++) {
+        Network net;
+        Matrix input, expected_output;
+        if (!load_bench_dataset(bench_datasets[d], &net, &input, &expected_output)) {
+            continue;
+        }
+
+        const Layer* output_layer = &net.layers[net.num_layers-1];
+        const LossFunc* loss_func = (output_layer->activation == &softmax) ? &CCE :
+            (output_layer->activation == &sigmoid) ? &BCE : &MSE;
+        int batch_size = (input.cols > 256) ? 256 : input.cols;
+        bench_network(bench_datasets[d], &net, &input, &expected_output, loss_func, batch_size);
+
+        free_matrix(&input);
+        free_matrix(&expected_output);
+        free_network(&net);
+    }
+
+    // A larger synthetic network, the size of a small image classifier.
+    int layer_sizes[] = {512, 256, 10};
+    const ActivationFunc* activations[] = {&ReLu, &ReLu, &softmax};
+    const WeightInit weight_inits[] = {He, He, Xavier};
+    Network net = init_neural_net(3, 784, layer_sizes, activations, weight_inits);
+    Matrix random_input = random_matrix(784, 256, 0.0, 1.0);
+    Matrix random_expected = random_one_hot(10, 256);
+    Matrix input = copy_with_layout(&random_input, MATRIX_COL_MAJOR);
+    Matrix expected_output = copy_with_layout(&random_expected, MATRIX_COL_MAJOR);
+    free_matrix(&random_input);
+    free_matrix(&random_expected);
+    bench_network("synthetic", &net, &input, &expected_output, &CCE, 256);
+    free_matrix(&input);
+    free_matrix(&expected_output);
+    free_network(&net);
+
+    for (int d=0; d < num_bench_datasets; d++) {
+        char path[128];
+        sprintf(path, "data/%s/train.csv", bench_datasets[d]);
+        bench_load(bench_datasets[d], path);
+    }
+
+    // A synthetic dataset large enough to be split across several threads when parsed.
+    char path[] = "/tmp/nn_bench_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd >= 0) {
+        close(fd);
+        if (write_synthetic_csv(path, 50000, 20, 5)) {
+            bench_load("synthetic", path);
+        }
+
+        char cache_path[sizeof(path) + 4];
+        sprintf(cache_path, "%s.bin", path);
+        remove(cache_path);
+        remove(path);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#ifndef DATASET_CACHE_H
+#define DATASET_CACHE_H
+
+typedef struct Matrix Matrix;
+
+// A dataset cache is a binary copy of a .csv dataset, stored next to it with ".bin" appended to its name. It
+// holds a header (the number of inputs, outputs and samples, and the size and modification time of the .csv
+// it was made from), followed by the input and expected output matrices, each stored dense column-major (one
+// sample directly after another, exactly as the loader lays them out in memory), and starting on a 64 KiB
+// boundary, so that each can be mapped straight into a matrix with a stride equal to its number of rows.
+
+// Writes the cache for the .csv dataset at csv_path from its already loaded matrices. The cache is written to
+// a temporary file that is then renamed, so concurrent readers never see a partly written cache. Returns 0 if
+// the cache could not be written, and 1 otherwise.
+int write_dataset_cache(const char* csv_path, const Matrix* input, const Matrix* expected_output);
+
+// Maps the input and expected output matrices from the cache of the .csv dataset at csv_path, without reading
+// the data itself, so takes the same time regardless of the size of the dataset. The mappings are private, so
+// changes to the matrices (such as shuffling) are never written back to the file. Returns 0, leaving the
+// matrices untouched, if there is no cache, or if it is out of date with the .csv or was written by a build
+// with a different precision; returns 1 otherwise.
+int load_dataset_cache(const char* csv_path, Matrix* input, Matrix* expected_output);
+
+// Parses the .csv dataset at csv_path and writes its cache. Returns 0 if the dataset could not be loaded or
+// the cache could not be written, and 1 otherwise.
+int convert_dataset_to_cache(const char* csv_path);
+
+#endif
\ No newline at end of file
@@ -3,7 +3,13 @@
 
 typedef struct Matrix Matrix;
 
-// Populates input and expected output matrices from a .csv dataset
+// Populates input and expected output matrices from a .csv dataset, mapping them from its binary cache (see
+// dataset_cache.h) if there is an up to date one, and otherwise parsing the .csv and then writing its cache.
+// Both matrices hold one sample per column, and are column-major, so that each sample is contiguous.
 void load_dataset_to_matrices(const char* file_path, Matrix* input, Matrix* expected_output);
 
+// Populates input and expected output matrices by parsing a .csv dataset, without using or writing its cache.
+// Returns 0, leaving the matrices empty, if the dataset could not be loaded, and 1 otherwise.
+int parse_csv_dataset(const char* file_path, Matrix* input, Matrix* expected_output);
+
 #endif
\ No newline at end of file
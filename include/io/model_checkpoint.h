@@ -0,0 +1,29 @@
+#ifndef MODEL_CHECKPOINT_H
+#define MODEL_CHECKPOINT_H
+
+#include "nn/neural_network.h" // For Network struct
+
+// A checkpoint stores a network in a versioned binary format: a header, which also records the network's math
+// accuracy, then the number of nodes, activation function and weight initialisation of each layer, then each
+// layer's weights and biases, stored exactly as they are laid out in memory and starting on 64-byte
+// boundaries.
+
+// How load_network gives the network its weights and biases.
+typedef enum CheckpointLoadMode {
+    CHECKPOINT_COPY, // Copied into memory owned by the network, which can then be trained further
+    CHECKPOINT_MAP // Mapped read-only from the file, for inference only (see below)
+} CheckpointLoadMode;
+
+// Saves the network's architecture, weights and biases to a checkpoint file. The checkpoint is written to a
+// temporary file that is then renamed, so a process loading it never sees a partly written checkpoint.
+// Returns 0 if the checkpoint could not be written, and 1 otherwise.
+int save_network(const Network* net, const char* file_path);
+
+// Loads a network from a checkpoint file. With CHECKPOINT_MAP, loading takes the same short time regardless of
+// the size of the network, and every process that maps the same checkpoint shares the same physical memory for
+// its weights. As the weights are read-only, a mapped network can only be used for inference (e.g. predict),
+// and must not be trained. Returns an empty network (with no layers) if the checkpoint could not be loaded, or
+// was saved by a build with a different precision.
+Network load_network(const char* file_path, CheckpointLoadMode mode);
+
+#endif
\ No newline at end of file
@@ -3,9 +3,11 @@
 
 typedef struct LossFunc LossFunc;
 typedef struct LearningRateSchedule LearningRateSchedule;
+typedef struct Optimizer Optimizer;
+typedef struct TrainingOptions TrainingOptions;
 
 // Extracts training parameters from a train_config.json file
 void extract_training_parameters(const char* file_path, const LossFunc** loss_func, int* num_epoch, 
-    LearningRateSchedule* lr_schedule);
+    LearningRateSchedule* lr_schedule, Optimizer* optimizer, TrainingOptions* options);
 
 #endif
\ No newline at end of file
@@ -1,9 +1,22 @@
 #ifndef ACTIVATION_H
 #define ACTIVATION_H
 
+#include "maths/scalar.h"
+
+// Applies an activation function to n consecutive elements of in, writing the results into out, which may be
+// the same buffer as in.
+typedef void (*ActivationKernel)(const Scalar* in, Scalar* out, int n);
+
+// Writes dL_dz = dL_da * f'(z) for n consecutive elements, where f'(z) is calculated from the activation's
+// output a = f(z), so no transcendental functions are evaluated again. dL_dz may be the same buffer as dL_da.
+typedef void (*ActivationBackwardKernel)(const Scalar* a, const Scalar* dL_da, Scalar* dL_dz, int n);
+
 typedef struct ActivationFunc {
-    double (*func_ptr)(double);
-    double (*derivative_ptr)(double);
+    Scalar (*func_ptr)(Scalar);
+    Scalar (*derivative_ptr)(Scalar);
+    ActivationKernel apply_ptr;
+    ActivationKernel fast_apply_ptr; // apply_ptr with bounded-error approximations, for networks using MATH_FAST
+    ActivationBackwardKernel backward_ptr;
 } ActivationFunc;
 
 // Custom included in tanh name to prevent conflict with tanh function in math.h
@@ -12,21 +25,39 @@ extern const ActivationFunc tanh_custom;
 extern const ActivationFunc ReLu;
 
 // 1 / (1 + e^{-x})
-double sigmoid_func(double x);
+Scalar sigmoid_func(Scalar x);
 
 // σ(x)(1 - σ(x)), where σ(x) is the sigmoid function
-double sigmoid_derivative(double x);
+Scalar sigmoid_derivative(Scalar x);
 
 // (e^{x} - e^{-x}) / (e^{x} + e^{-x})
-double tanh_func(double x);
+Scalar tanh_func(Scalar x);
 
 // 1 - (tanh(x))^{2}
-double tanh_derivative(double x);
+Scalar tanh_derivative(Scalar x);
 
 // max(0, x)
-double ReLu_func(double x);
+Scalar ReLu_func(Scalar x);
 
 // 1 if x > 0, otherwise 0
-double ReLu_derivative(double x);
+Scalar ReLu_derivative(Scalar x);
+
+// Array-at-a-time forms of the functions above, which avoid a function call per element and can be vectorised.
+void sigmoid_apply(const Scalar* in, Scalar* out, int n);
+void tanh_apply(const Scalar* in, Scalar* out, int n);
+void ReLu_apply(const Scalar* in, Scalar* out, int n);
+
+// Array-at-a-time forms using fast_sigmoid and fast_tanh (see fast_math.h). ReLu needs no approximation.
+void sigmoid_fast_apply(const Scalar* in, Scalar* out, int n);
+void tanh_fast_apply(const Scalar* in, Scalar* out, int n);
+
+// dL_da * a(1 - a), as σ'(z) = σ(z)(1 - σ(z))
+void sigmoid_backward(const Scalar* a, const Scalar* dL_da, Scalar* dL_dz, int n);
+
+// dL_da * (1 - a^{2}), as tanh'(z) = 1 - (tanh(z))^{2}
+void tanh_backward(const Scalar* a, const Scalar* dL_da, Scalar* dL_dz, int n);
+
+// dL_da if a > 0, otherwise 0, as ReLu(z) > 0 exactly when z > 0
+void ReLu_backward(const Scalar* a, const Scalar* dL_da, Scalar* dL_dz, int n);
 
 #endif
\ No newline at end of file
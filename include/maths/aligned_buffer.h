@@ -0,0 +1,66 @@
+#ifndef ALIGNED_BUFFER_H
+#define ALIGNED_BUFFER_H
+
+#include <stddef.h>
+
+// Alignment of every buffer allocated for matrix data: the size of a cache line, which is also the width of the
+// widest SIMD vectors in use (AVX-512).
+#define BUFFER_ALIGNMENT 64
+
+// Size of a transparent huge page on x86-64.
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+// Largest buffer kept for reuse by the buffer pool. Larger buffers always come from (and return to) the system
+// allocator.
+#define MAX_POOLED_BYTES (64 * 1024 * 1024)
+
+// Counts of the buffers allocated since the program started. Byte counts are of whole size classes when the
+// pool is enabled, so may be slightly more than was asked for.
+typedef struct BufferStats {
+    size_t allocations; // Buffers allocated, whether reused from the pool or not
+    size_t pool_hits; // Allocations served by reusing a pooled buffer
+    size_t system_allocations; // Allocations that had to get memory from the system allocator
+    size_t frees;
+    size_t bytes_in_use; // Bytes of buffers currently allocated
+    size_t peak_bytes_in_use;
+    size_t bytes_pooled; // Bytes of freed buffers held by the pool for reuse
+} BufferStats;
+
+// Allocates a buffer of at least the given number of bytes, starting on a BUFFER_ALIGNMENT boundary, with its
+// contents uninitialised. Returns NULL if the allocation failed.
+//
+// If the pool is enabled by setting the NN_MATRIX_POOL environment variable to 1, sizes are rounded up to one
+// of four size classes per power of two, and freed buffers are kept on free lists for their size class to be
+// handed out again, so that repeatedly allocating and freeing matrices of the same shapes stops calling
+// malloc. Each thread keeps a small cache of free buffers that it takes from without locking, which spills
+// into a shared, locked pool when it fills up.
+//
+// If huge pages are enabled by setting the NN_HUGE_PAGES environment variable to 1, buffers of at least
+// HUGE_PAGE_SIZE bytes are instead allocated on a huge page boundary and advised to be backed by transparent
+// huge pages with madvise, which cuts the TLB misses of walking them.
+void* alloc_aligned(size_t bytes);
+
+// alloc_aligned, with the buffer's contents set to zero.
+void* alloc_aligned_zeroed(size_t bytes);
+
+// Frees a buffer allocated by alloc_aligned or alloc_aligned_zeroed, returning it to the pool if it is enabled.
+// May be called from a different thread than the one that allocated the buffer. Does nothing if buffer is NULL.
+void free_aligned(void* buffer);
+
+// Returns every free buffer held by the shared pool, and by the calling thread's cache, to the system allocator.
+void release_pooled_buffers();
+
+// Returns a snapshot of the allocation counters. Counters are updated without locking, so a snapshot taken
+// while other threads allocate may not be consistent between counters.
+BufferStats buffer_stats();
+
+// Fraction of allocations served from the pool, or 0 if there have been none.
+double pool_hit_rate(const BufferStats* stats);
+
+// Whether freed buffers are pooled for reuse.
+int buffer_pool_enabled();
+
+// Whether large buffers are backed by transparent huge pages.
+int huge_pages_enabled();
+
+#endif
\ No newline at end of file
@@ -0,0 +1,28 @@
+#ifndef FAST_MATH_H
+#define FAST_MATH_H
+
+#include "maths/scalar.h"
+
+// Which implementations of exp, log, tanh and sigmoid a network uses in its activations, softmax and loss:
+// the C library's (MATH_EXACT), or the approximations below (MATH_FAST), which are evaluated on whole arrays at
+// once in SIMD registers.
+typedef enum MathAccuracy {
+    MATH_EXACT,
+    MATH_FAST
+} MathAccuracy;
+
+// Approximations built from a range reduction followed by a polynomial, whose errors are measured against the
+// C library by the fast_math benchmarks. Within the ranges below, in both double and float builds, their errors
+// are within:
+// - fast_exp: 2 ulp (units in the last place of the result), for x up to 709 (88 for float), above which it
+//   returns infinity. Below -708 (-87 for float) it returns 0.
+// - fast_log: 3 ulp, for positive normal x. Zero, negative, subnormal and non-finite x are not supported.
+// - fast_sigmoid and fast_tanh: 2 ulp of 1, as an absolute error, for every finite x. They are only bounded in
+//   absolute error: relative errors are far larger where the result is close to 0, up to around 3600 ulp for
+//   fast_tanh in double and 1200 ulp in float.
+Scalar fast_exp(Scalar x);
+Scalar fast_log(Scalar x);
+Scalar fast_sigmoid(Scalar x);
+Scalar fast_tanh(Scalar x);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,38 @@
+#ifndef GEMM_H
+#define GEMM_H
+
+#include "maths/scalar.h"
+
+// Whether an operand of gemm is used as stored, or as its transpose.
+typedef enum GemmTranspose {
+    GEMM_NO_TRANS,
+    GEMM_TRANS
+} GemmTranspose;
+
+// Extra work done on C once its final value has been computed, so that it does not need separate passes over C
+// afterwards. The bias is added to each tile while it is still in registers, and the activation is applied to
+// each finished block of rows while it is still in cache, in runs as long as the block so that array kernels
+// can be vectorised.
+typedef struct GemmEpilogue {
+    const Scalar* row_bias; // If not NULL, row_bias[i * bias_stride] is added to every element of row i of C
+    const Scalar* col_bias; // If not NULL, col_bias[j * bias_stride] is added to every element of column j of C
+    int bias_stride;
+    // If not NULL, applied to runs of each row of C once they are finished, writing the n results into out. Runs
+    // of consecutive rows are passed at once when both C and out store them contiguously.
+    void (*activation)(const Scalar* in, Scalar* out, int n);
+    Scalar* out; // m x n buffer with rows ldout elements apart, which may be C itself but must not overlap A or B
+    int ldout;
+} GemmEpilogue;
+
+// General matrix multiplication on raw row-major buffers: C = op(A) * op(B), where op(A) is m x k, op(B) is
+// k x n and C is m x n. Each op either uses the buffer as stored or reads it as its transpose, so transposed
+// operands never need to be materialised. lda, ldb and ldc are the distances (in elements) between the
+// starts of consecutive rows of each buffer as stored. C is overwritten, and must not overlap A or B.
+void gemm(GemmTranspose trans_a, GemmTranspose trans_b, int m, int n, int k, const Scalar* a, int lda,
+    const Scalar* b, int ldb, Scalar* c, int ldc);
+
+// gemm followed by an epilogue applied to C, which may be NULL to apply none.
+void gemm_epilogue(GemmTranspose trans_a, GemmTranspose trans_b, int m, int n, int k, const Scalar* a, int lda,
+    const Scalar* b, int ldb, Scalar* c, int ldc, const GemmEpilogue* epilogue);
+
+#endif
\ No newline at end of file
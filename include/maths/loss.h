@@ -2,10 +2,15 @@
 #define LOSS_H
 
 #include "maths/matrix.h" // For Matrix struct and matrix operations
+#include "maths/fast_math.h" // For MathAccuracy
 
 typedef struct LossFunc {
     double (*func_ptr)(const Matrix*, const Matrix*);
     Matrix (*derivative_ptr)(const Matrix*, const Matrix*);
+    void (*derivative_into_ptr)(Matrix*, const Matrix*, const Matrix*); // Writes into an existing matrix
+
+    // Writes the derivative into an existing matrix and returns the loss, computing both in a single pass
+    double (*with_derivative_into_ptr)(Matrix*, const Matrix*, const Matrix*);
 } LossFunc;
 
 extern const LossFunc MSE;
@@ -13,18 +18,43 @@ extern const LossFunc MAE;
 extern const LossFunc BCE;
 extern const LossFunc CCE;
 
+// Like the allocating matrix operations, the allocating derivatives return a matrix with the layout of y.
+
 // Regression loss functions
 double mean_squared_error(const Matrix* y, const Matrix* y_pred);
 Matrix mean_squared_error_derivative(const Matrix* y, const Matrix* y_pred);
+void mean_squared_error_derivative_into(Matrix* gradient_matrix, const Matrix* y, const Matrix* y_pred);
+double mean_squared_error_with_derivative_into(Matrix* gradient_matrix, const Matrix* y, const Matrix* y_pred);
 
 double mean_absolute_error(const Matrix* y, const Matrix* y_pred);
 Matrix mean_absolute_error_derivative(const Matrix* y, const Matrix* y_pred);
+void mean_absolute_error_derivative_into(Matrix* gradient_matrix, const Matrix* y, const Matrix* y_pred);
+double mean_absolute_error_with_derivative_into(Matrix* gradient_matrix, const Matrix* y, const Matrix* y_pred);
 
 // Classification loss functions
 double binary_cross_entropy(const Matrix* y, const Matrix* y_pred);
 Matrix binary_cross_entropy_derivative(const Matrix* y, const Matrix* y_pred);
+void binary_cross_entropy_derivative_into(Matrix* gradient_matrix, const Matrix* y, const Matrix* y_pred);
+double binary_cross_entropy_with_derivative_into(Matrix* gradient_matrix, const Matrix* y, const Matrix* y_pred);
 
 double categorical_cross_entropy(const Matrix* y, const Matrix* y_pred);
 Matrix categorical_cross_entropy_derivative(const Matrix* y, const Matrix* y_pred);
+void categorical_cross_entropy_derivative_into(Matrix* gradient_matrix, const Matrix* y, const Matrix* y_pred);
+double categorical_cross_entropy_with_derivative_into(Matrix* gradient_matrix, const Matrix* y, const Matrix* y_pred);
+
+// Gradients of a loss with respect to the pre-activation output z of an output layer, for loss and activation
+// pairs where the product of their derivatives simplifies. y_pred is the output of the activation, and the
+// gradient is written into gradient_matrix, which must have the same dimensions as y. The loss itself is
+// calculated in the same pass, and returned, with its logarithms taken by fast_log for MATH_FAST. Logarithms
+// are only taken for terms with non-zero weight, so for one-hot or 0/1 labels one is taken per sample or
+// element respectively.
+
+// Softmax followed by CCE: (y_pred - y) / number of samples, given that each column of y sums to 1.
+double softmax_cross_entropy_gradient_into(Matrix* gradient_matrix, const Matrix* y, const Matrix* y_pred,
+    MathAccuracy accuracy);
+
+// Sigmoid followed by BCE: (y_pred - y) / number of elements.
+double sigmoid_binary_cross_entropy_gradient_into(Matrix* gradient_matrix, const Matrix* y, const Matrix* y_pred,
+    MathAccuracy accuracy);
 
 #endif
\ No newline at end of file
@@ -1,50 +1,144 @@
 #ifndef MATRIX_H
 #define MATRIX_H
 
+#include <stddef.h>
+#include "maths/scalar.h"
+
+// Where a matrix's data lives, which determines how free_matrix releases it.
+typedef enum MatrixStorage {
+    MATRIX_OWNED, // Allocated on the heap for the matrix, and freed by free_matrix
+    MATRIX_VIEW, // Part of memory owned by something else, which free_matrix leaves untouched
+    MATRIX_MAPPED // A memory-mapped region of a file, which free_matrix unmaps
+} MatrixStorage;
+
+// The order in which a matrix's elements are stored. Datasets and the network's batches hold one sample per
+// column, so are stored column-major, which makes each sample (and each range of consecutive samples) one
+// contiguous block of memory.
+typedef enum MatrixLayout {
+    MATRIX_ROW_MAJOR, // 1st row, then 2nd row, etc.
+    MATRIX_COL_MAJOR // 1st column, then 2nd column, etc.
+} MatrixLayout;
+
 typedef struct Matrix {
     int rows;
     int cols;
-    double* data; // Pointer to matrix data. Data is stored in a 1D array: 1st row, then 2nd row, etc.
+    Scalar* data; // Pointer to matrix data. Data is stored in a 1D array, in the order given by layout.
+    // Distance between the starts of consecutive rows (or columns, for column-major matrices). Row-major
+    // matrices created by create_matrix pad their rows to whole 64-byte cache lines, and views of part of a
+    // matrix share its stride, so this may be greater than cols (or rows).
+    int stride;
+    MatrixStorage storage;
+    MatrixLayout layout;
 } Matrix; // Alias for struct Matrix
 
-// Creates a matrix with the given dimensions, with all elements initialised to 0.
+// Most operations come in two forms: one that allocates and returns a new matrix for its result, and an
+// "_into" form that writes its result into an existing matrix of the correct dimensions without allocating.
+// Unless stated otherwise, the result of an "_into" operation may be the same matrix as one of its operands.
+// Operands may have different layouts, and results of the allocating forms have the layout of the first operand,
+// but element-wise operations are only vectorised when every matrix has the same layout.
+
+// Creates a row-major matrix with the given dimensions, with all elements initialised to 0. Its data starts on a
+// cache line boundary, and each row is padded to a whole number of cache lines unless it holds a single element.
+// Column-major matrices, which hold datasets, are stored dense, with a stride equal to their number of rows.
+// Large matrices may be backed by huge pages (see aligned_buffer.h).
 Matrix create_matrix(int rows, int cols);
+Matrix create_matrix_with_layout(int rows, int cols, MatrixLayout layout);
+
+// Creates a matrix like create_matrix_with_layout, but without initialising its elements, for results that are
+// about to be overwritten. Skips the pass clearing the memory, which for a pooled buffer (see aligned_buffer.h)
+// would be the only pass over it besides the one writing the result.
+Matrix create_uninitialised_matrix(int rows, int cols, MatrixLayout layout);
 
 // Returns an empty matrix, with dimensions of 0 by 0 and with data pointer set to NULL.
 Matrix empty_matrix();
 
-// Frees memory allocated for a matrix.
+// Returns a row-major matrix with the given dimensions that uses existing data, such as part of a larger buffer.
+// The matrix does not own its data, so free_matrix does not free it.
+Matrix matrix_view(Scalar* data, int rows, int cols);
+Matrix matrix_view_with_layout(Scalar* data, int rows, int cols, MatrixLayout layout);
+
+// Returns a view of num_cols consecutive columns of a matrix, starting from first_col, without copying. For a
+// column-major matrix, the view is a single contiguous block. For a row-major one, rows of the view are not
+// contiguous with each other (its stride is that of the original matrix). The view shares the original
+// matrix's data, so writes through it modify the original, and free_matrix does not free it.
+Matrix matrix_column_view(const Matrix* matrix, int first_col, int num_cols);
+
+// Returns a row-major view of how a matrix is stored: the matrix itself if it is row-major, or a view of its
+// transpose if it is column-major. Element-wise operations on matrices of the same layout can be written once,
+// a row at a time, and applied to these views.
+Matrix matrix_storage_view(const Matrix* matrix);
+
+// Returns a matrix with the given layout whose data is a memory mapping of rows * cols elements, created with
+// mmap, which is owned by the matrix and unmapped by free_matrix.
+Matrix matrix_mapped(Scalar* data, int rows, int cols, MatrixLayout layout);
+
+// Returns the number of bytes spanned by a matrix's data, including the padding of each row.
+size_t matrix_storage_bytes(const Matrix* matrix);
+
+// Frees memory allocated for a matrix (or unmaps it, for mapped matrices). Views are only reset to empty.
 void free_matrix(Matrix* matrix);
 
-// Creates a deep copy of a matrix.
+// Gives a matrix the specified dimensions, keeping its layout, and only reallocating if its number of elements
+// changes. The contents of the matrix are unspecified afterwards.
+void resize_matrix(Matrix* matrix, int rows, int cols);
+
+// Creates a deep copy of a matrix, with the same layout. copy_matrix_into may also be used to convert between
+// layouts.
 Matrix copy_matrix(const Matrix* original);
+void copy_matrix_into(Matrix* result, const Matrix* original);
 
 // Sets the value of the specified element of a matrix.
-void set_element(Matrix* matrix, int row, int col, double data_item);
+void set_element(Matrix* matrix, int row, int col, Scalar data_item);
 
 // Returns the value of the specified element of a matrix.
-double get_element(const Matrix* matrix, int row, int col);
+Scalar get_element(const Matrix* matrix, int row, int col);
 
 // Calculates and returns the resulting matrix from adding the two matrices.
 Matrix matrix_addition(const Matrix* matrix_a, const Matrix* matrix_b);
+void matrix_addition_into(Matrix* result, const Matrix* matrix_a, const Matrix* matrix_b);
+
+// Adds alpha times matrix X to matrix Y, in place (Y = alpha * X + Y).
+void matrix_axpy(Matrix* matrix_y, Scalar alpha, const Matrix* matrix_x);
 
-// Calculates and returns the resulting matrix from multiplying the two matrices.
+// Calculates and returns the resulting matrix from multiplying the two matrices. The result of the "_into"
+// form must not be the same matrix as either operand.
 Matrix matrix_multiplication(const Matrix* matrix_a, const Matrix* matrix_b);
+void matrix_multiplication_into(Matrix* result, const Matrix* matrix_a, const Matrix* matrix_b);
+
+// Calculates and returns op(A) * op(B), where op(A) is the transpose of matrix_a if transpose_a is non-zero
+// (and likewise for B). Transposed operands are read in place, without constructing their transposes. The
+// result of the "_into" form must not be the same matrix as either operand.
+Matrix matrix_multiplication_transposed(const Matrix* matrix_a, int transpose_a, const Matrix* matrix_b,
+    int transpose_b);
+void matrix_multiplication_transposed_into(Matrix* result, const Matrix* matrix_a, int transpose_a,
+    const Matrix* matrix_b, int transpose_b);
+
+// Computes z = A * B + bias, where bias is a column vector added to every column, and then a = func(z) for
+// each element, applying the bias and func to each part of the product as it is finished rather than in
+// separate passes. func is an array-at-a-time kernel, given runs of finished rows at once. If func is NULL, a
+// is not written (and may be NULL). a may be the same matrix as z, in which case only the activations are
+// kept, but neither may be the same matrix as A or B, and a must have the same layout as z.
+void matrix_multiplication_bias_func_into(Matrix* z, Matrix* a, const Matrix* matrix_a, const Matrix* matrix_b,
+    const Matrix* bias, void (*func)(const Scalar* in, Scalar* out, int n));
 
 // Multiplies each element in a matrix by a scalar value.
-Matrix matrix_scalar_multiplication(const Matrix* matrix, double multiplier);
+Matrix matrix_scalar_multiplication(const Matrix* matrix, Scalar multiplier);
+void matrix_scalar_multiplication_into(Matrix* result, const Matrix* matrix, Scalar multiplier);
 
 // Calculates and returns the resulting matrix from performing the Hadamard product of two matrices.
 Matrix hadamard_product(const Matrix* matrix_a, const Matrix* matrix_b);
+void hadamard_product_into(Matrix* result, const Matrix* matrix_a, const Matrix* matrix_b);
 
 // Adds two matrices by broadcasting.
 Matrix matrix_broadcast_addition(const Matrix* matrix_a, const Matrix* matrix_b);
+void matrix_broadcast_addition_into(Matrix* result, const Matrix* matrix_a, const Matrix* matrix_b);
 
-// Constructs and returns the transpose of the matrix.
+// Constructs and returns the transpose of the matrix, with the same layout.
 Matrix transpose(const Matrix* matrix);
 
 // Applies a given function to each element in a matrix.
-void apply_func(Matrix* matrix, double (*activation)(double));
+void apply_func(Matrix* matrix, Scalar (*activation)(Scalar));
+void apply_func_into(Matrix* result, const Matrix* matrix, Scalar (*activation)(Scalar));
 
 // Displays a matrix in a more human-readable format for testing purposes.
 void display_matrix(const Matrix* matrix);
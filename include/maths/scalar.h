@@ -0,0 +1,16 @@
+#ifndef SCALAR_H
+#define SCALAR_H
+
+// Element type of every matrix, and so of the network's parameters, activations and gradients. It is chosen at
+// build time: defining NN_FLOAT32 (e.g. with `make PRECISION=float`) halves the memory used by matrices and
+// doubles the number of elements each SIMD instruction processes, at the cost of precision. Reductions such
+// as loss values are still accumulated in double in both builds.
+#ifdef NN_FLOAT32
+typedef float Scalar;
+#define SCALAR_NAME "float32"
+#else
+typedef double Scalar;
+#define SCALAR_NAME "float64"
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,60 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include "maths/scalar.h"
+
+// Instruction set levels that element-wise kernels are compiled for, from least to most capable.
+typedef enum SimdLevel {
+    SIMD_SCALAR,
+    SIMD_SSE2,
+    SIMD_AVX2,
+    SIMD_AVX512
+} SimdLevel;
+
+// Element-wise kernels over contiguous arrays of n Scalars, compiled for a single instruction set. The output
+// array may be the same as an input array, but must not otherwise overlap one.
+typedef struct SimdKernels {
+    SimdLevel level;
+    const char* name;
+
+    // out = a + b
+    void (*add)(const Scalar* a, const Scalar* b, Scalar* out, int n);
+    // out = a * b
+    void (*multiply)(const Scalar* a, const Scalar* b, Scalar* out, int n);
+    // out = a * scalar
+    void (*scale)(const Scalar* a, Scalar scalar, Scalar* out, int n);
+    // out = a + scalar
+    void (*add_scalar)(const Scalar* a, Scalar scalar, Scalar* out, int n);
+    // y = alpha * x + y
+    void (*axpy)(Scalar alpha, const Scalar* x, Scalar* y, int n);
+
+    // Momentum update of parameters w with gradients g and velocity v: v = momentum * v + g, then
+    // w -= lr * v, or w -= lr * (g + momentum * v) if nesterov is set
+    void (*momentum_update)(Scalar* w, const Scalar* g, Scalar* v, Scalar lr, Scalar momentum, int nesterov,
+        int n);
+    // Adam update of parameters w with gradients g and moment estimates m and v: m = beta1 * m + (1-beta1) * g,
+    // v = beta2 * v + (1-beta2) * g * g, then w -= step_size * m / (sqrt(v) + epsilon)
+    void (*adam_update)(Scalar* w, const Scalar* g, Scalar* m, Scalar* v, Scalar beta1, Scalar beta2,
+        Scalar step_size, Scalar epsilon, int n);
+
+    // out = max(a, 0)
+    void (*relu)(const Scalar* a, Scalar* out, int n);
+    // Derivatives of activations multiplied by the incoming gradient g, calculated from the activations a:
+    // out = g * a * (1 - a) for sigmoid, out = g * (1 - a * a) for tanh, and out = g if a > 0 (otherwise 0)
+    // for ReLu
+    void (*sigmoid_backward)(const Scalar* a, const Scalar* g, Scalar* out, int n);
+    void (*tanh_backward)(const Scalar* a, const Scalar* g, Scalar* out, int n);
+    void (*relu_backward)(const Scalar* a, const Scalar* g, Scalar* out, int n);
+
+    // out = f(a) for the approximations of f declared in fast_math.h, with the same error bounds
+    void (*fast_exp)(const Scalar* a, Scalar* out, int n);
+    void (*fast_log)(const Scalar* a, Scalar* out, int n);
+    void (*fast_sigmoid)(const Scalar* a, Scalar* out, int n);
+    void (*fast_tanh)(const Scalar* a, Scalar* out, int n);
+} SimdKernels;
+
+// Returns the kernels selected at startup: those for the most capable instruction set supported by the CPU,
+// unless the NN_SIMD_LEVEL environment variable (scalar, sse2, avx2 or avx512) forces a specific level.
+const SimdKernels* get_simd_kernels();
+
+#endif
\ No newline at end of file
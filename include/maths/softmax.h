@@ -8,7 +8,14 @@
 extern const ActivationFunc softmax; 
 
 Matrix softmax_func(const Matrix* x);
+void softmax_func_into(Matrix* result, const Matrix* x);
+
+// Softmax using fast_exp (see fast_math.h), for networks using MATH_FAST. For row-major matrices, columns are
+// processed in blocks, a row at a time, so each step runs on a contiguous run of elements with the SIMD kernels,
+// and column-major matrices are exponentiated as a whole. result may be the same matrix as x.
+void softmax_fast_func_into(Matrix* result, const Matrix* x);
 
 Matrix softmax_derivative(const Matrix* x, const Matrix* loss_deriv);
+void softmax_derivative_into(Matrix* gradient_matrix, const Matrix* x, const Matrix* loss_deriv);
 
 #endif
\ No newline at end of file
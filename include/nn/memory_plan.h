@@ -0,0 +1,22 @@
+#ifndef MEMORY_PLAN_H
+#define MEMORY_PLAN_H
+
+#include <stddef.h>
+
+// A buffer to be given space in a slab, which is live from step first_use to step last_use (inclusive) of a
+// fixed schedule, such as the steps of a training step. Sizes and offsets may be in any unit, as long as it is
+// the same for both. If every size is a multiple of some alignment, so is every offset.
+typedef struct PlannedBuffer {
+    size_t size;
+    int first_use;
+    int last_use;
+    size_t offset; // Set by plan_buffers
+} PlannedBuffer;
+
+// Assigns each buffer an offset in a single slab, so that buffers that are live at the same time never overlap,
+// while buffers whose lifetimes are disjoint may share space, and returns the size the slab needs to be. Buffers
+// are placed largest first, each at the lowest offset where it does not overlap any already placed buffer that
+// is live at the same time as it.
+size_t plan_buffers(PlannedBuffer* buffers, int count);
+
+#endif
\ No newline at end of file
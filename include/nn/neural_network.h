@@ -1,31 +1,86 @@
 #ifndef NEURAL_NETWORK_H
 #define NEURAL_NETWORK_H
 
+#include <stddef.h> // For size_t
 #include "maths/matrix.h" // For Matrix struct and matrix operations
+#include "maths/fast_math.h" // For MathAccuracy
 
-// Forward declaration of struct defined in activation.h, and typedef defined in weight_init.h
+// Forward declaration of structs defined in activation.h and memory_plan.h, and typedef defined in weight_init.h
 typedef struct ActivationFunc ActivationFunc;
+typedef struct PlannedBuffer PlannedBuffer;
 typedef void (*WeightInit)(struct Matrix*);
 
 typedef struct Layer {
     Matrix weights;
     Matrix biases;
     const ActivationFunc* activation;
+    WeightInit weight_init; // How the weights were initialised, which is recorded in saved checkpoints
     int num_nodes;
 
+    // The following matrices are views into the network's workspace, with one column per sample in the
+    // current batch (except dL_dw and dL_db), and the same layout as the batch's input. Matrices that are never
+    // needed at the same time share memory, so each only holds its value while it is in use: z during the
+    // layer's own forward step, a from then until backpropagation reaches the layer, dL_da and dL_dz during
+    // backpropagation, and dL_dw and dL_db from backpropagation until the next forward pass. In lean mode (see
+    // set_workspace_memory), z is the same matrix as a, and dL_da as dL_dz, for element-wise activations.
     Matrix z; // Pre-activation output of layer
     Matrix a; // Post-activation output of layer
 
+    Matrix dL_da; // Matrix of partial derivative of loss with respect to a
     Matrix dL_dz; // Matrix of partial derivative of loss with respect to z (z = wx + b)
     Matrix dL_dw; // Matrix of partial derivative of loss with respect to weights
     Matrix dL_db; // Matrix of partial derivative of loss with respect to biases
+
+    // Optimizer state, with the same dimensions as the weights and biases, allocated when training starts. The
+    // first moments hold the velocity for momentum and the mean of the gradients for Adam, and the second
+    // moments the uncentred variance of the gradients for Adam. Unused moments are empty matrices.
+    Matrix weights_moment1;
+    Matrix weights_moment2;
+    Matrix biases_moment1;
+    Matrix biases_moment2;
 } Layer;
 
+// A single buffer holding every layer's z, a and derivative matrices, sized for batches of up to max_batch
+// samples. Each layer's matrices are views into it, so forward and backward passes never allocate. The offset
+// of each matrix is planned from the order in which a training step uses them, so that matrices whose
+// lifetimes do not overlap share memory (see memory_plan.h).
+typedef struct Workspace {
+    Scalar* buffer;
+    size_t bytes;
+    size_t unplanned_bytes; // Size the buffer would be if every matrix had memory of its own
+    int max_batch;
+    PlannedBuffer* plan; // Where each layer's matrices are in the buffer
+
+    // How the intermediates are stored (see set_workspace_memory).
+    int lean;
+    int checkpoint_interval;
+} Workspace;
+
 typedef struct Network {
     Layer* layers;
     int num_layers;
+    Workspace workspace;
+
+    // Whether the activations, softmax and the loss calculated during training use the C library's exp, log
+    // and tanh, or the faster approximations in fast_math.h. Networks start with MATH_EXACT.
+    MathAccuracy math_accuracy;
+
+    // If the network was loaded from a memory-mapped checkpoint, its weights and biases are read-only views
+    // into this mapping, which free_network unmaps. Otherwise NULL.
+    void* checkpoint_mapping;
+    size_t checkpoint_mapping_bytes;
 } Network;
 
+// Scratch memory for inference, which holds two buffers, each large enough for the output of the widest layer
+// over a batch of up to max_batch samples. Layers alternate between them, each reading its input from one and
+// writing its output to the other. A scratch is owned by its caller rather than by the network, so threads
+// running inference on the same network concurrently each need their own.
+typedef struct InferenceScratch {
+    Scalar* buffer;
+    size_t bytes;
+    int max_batch;
+} InferenceScratch;
+
 // Initialises a neural network with the given number of layers, and number of nodes for each layer.
 Network init_neural_net(int num_layers, int input_nodes, int layer_sizes[], const ActivationFunc* activations[],
     const WeightInit weight_init_fns[]);
@@ -33,8 +88,72 @@ Network init_neural_net(int num_layers, int input_nodes, int layer_sizes[], cons
 // Frees memory allocated to pointers and matrices in a Network struct and its Layer structs.
 void free_network(Network* net);
 
+// Creates a network that shares the weights and biases of an existing network (including any later updates to
+// them), but has its own workspace, so that passes can run on each of them concurrently. The replica must be
+// freed with free_replica, and not outlive the original network.
+Network create_replica(const Network* net);
+
+// Frees a replica's workspace and layers, without freeing the weights and biases it shares.
+void free_replica(Network* replica);
+
+// Allocates the network's workspace for batches of up to max_batch samples. Does nothing if the existing
+// workspace is already large enough, and otherwise replaces it; forward passes over larger batches than the
+// workspace was sized for will also replace it. Returns 0 if allocation failed, and 1 otherwise.
+int reserve_workspace(Network* net, int max_batch);
+
+// Sets how the network's workspace stores the intermediates of training, replanning it if this changes. By
+// default, every layer's z, a, dL_da and dL_dz has space of its own for as long as it is needed. In lean mode,
+// element-wise activations and their derivatives are computed in place, so z and dL_da take no space of their
+// own. If checkpoint_interval is greater than 1, only every checkpoint_interval-th layer's output (and the output
+// layer's, and those of softmax layers) is kept from the forward pass for backpropagation. The others are
+// recomputed from the last kept output below them when backpropagation reaches the layer above, which costs
+// up to one extra forward pass but means that only checkpoint_interval layers' outputs are held at once,
+// besides the kept ones. Neither changes the results of training. 0 turns checkpointing off.
+void set_workspace_memory(Network* net, int lean, int checkpoint_interval);
+
+// Called by backpropagation before it runs through a layer: if the outputs below the layer were not kept
+// because of checkpointing, recomputes them from the input of the network, or the last output that was kept.
+void recompute_layer_inputs(Network* net, const Matrix* input, int layer_index);
+
+// Returns the total size of the network's workspace in bytes.
+size_t workspace_bytes(const Network* net);
+
+// Returns the size the network's workspace would be in bytes if none of its matrices shared memory.
+size_t unplanned_workspace_bytes(const Network* net);
+
+// Returns the size in bytes of the workspace reserve_workspace would allocate for batches of up to max_batch
+// samples, without allocating it, so that the largest network or batch that fits in memory can be found.
+size_t planned_workspace_bytes(const Network* net, int max_batch);
+
 // Performs forward pass of data through neural net: each layer's output is calculated, and given to the
-// next layer as input until the output layer is reached.
+// next layer as input until the output layer is reached. Returns a copy of the output.
 Matrix forward_pass(Network* net, const Matrix* input);
 
+// Allocates scratch for inference with the network over batches of up to max_batch samples, doing nothing if
+// the existing scratch is already large enough. Scratch should start as {NULL, 0, 0}. Returns 0 if allocation
+// failed, and 1 otherwise.
+int reserve_inference_scratch(InferenceScratch* scratch, const Network* net, int max_batch);
+
+// Frees the buffer of an inference scratch.
+void free_inference_scratch(InferenceScratch* scratch);
+
+// Runs the network on the input for inference only, returning its output, with the same layout as the input.
+// Unlike forward_pass, the intermediate outputs of each layer are not kept, and the network itself is not
+// modified, so multiple threads can run inference on the same network at once.
+Matrix predict(const Network* net, const Matrix* input);
+
+// Writes the network's output for the input into output, which must have one row per output node and one
+// column per sample. Intermediate outputs are kept in the scratch, which is grown if it is too small for the
+// batch, so this does not allocate once the scratch is large enough.
+void predict_into(Matrix* output, const Network* net, const Matrix* input, InferenceScratch* scratch);
+
+// Performs the same forward pass, but returns a pointer to the output layer's own post-activation output 
+// rather than a copy. Layer outputs live in the network's workspace, so this does not allocate unless the
+// batch is larger than the workspace. The returned matrix is overwritten by the next pass.
+const Matrix* forward_pass_into_layers(Network* net, const Matrix* input);
+
+// Performs the same forward pass as forward_pass_into_layers, adding the wall-clock time spent on each layer
+// onto the corresponding element of layer_seconds, which must have one element per layer.
+const Matrix* forward_pass_timed(Network* net, const Matrix* input, double* layer_seconds);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,51 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <stddef.h>
+
+typedef struct Network Network; // Forward declaration
+
+typedef enum OptimizerType {
+    SGD,
+    MOMENTUM,
+    NESTEROV,
+    ADAM
+} OptimizerType;
+
+typedef struct MomentumParams {
+    double momentum;
+} MomentumParams;
+
+typedef struct AdamParams {
+    double beta1;
+    double beta2;
+    double epsilon;
+} AdamParams;
+
+typedef struct Optimizer {
+    OptimizerType type;
+
+    union {
+        MomentumParams momentum; // Used by both MOMENTUM and NESTEROV
+        AdamParams adam;
+    } param;
+} Optimizer;
+
+// Allocates the optimizer state of every layer of the network, or resets it to zero if it is already allocated,
+// so that training starts from a fresh state. Returns 0 if an allocation failed, and 1 otherwise.
+int init_optimizer_state(Network* net, const Optimizer* optimizer);
+
+// Updates the weights and biases of every layer in place from the gradients in its dL_dw and dL_db, in a single
+// pass over the parameters, gradients and optimizer state of each. step is the number of updates made since
+// the state was initialised, including this one, which Adam uses to correct the bias of its moment estimates.
+void optimizer_step(Network* net, const Optimizer* optimizer, double learning_rate, int step);
+
+// Performs the same update as optimizer_step, adding the wall-clock time spent on each layer onto the
+// corresponding element of layer_seconds, which must have one element per layer.
+void optimizer_step_timed(Network* net, const Optimizer* optimizer, double learning_rate, int step,
+    double* layer_seconds);
+
+// Returns the size in bytes of the optimizer state of every layer of the network.
+size_t optimizer_state_bytes(const Network* net);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,57 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+// Wall-clock time spent by one layer in each phase of training over an epoch.
+typedef struct LayerStats {
+    double forward_seconds;
+    double backward_seconds;
+    double optimizer_seconds;
+} LayerStats;
+
+// Statistics of one epoch of training. Times are wall-clock times in seconds. With more than one training
+// thread, the forward, backward and loss times are those of the calling thread, which processes its share of
+// each batch at the same time as the other threads, and the backward time also includes summing the threads'
+// gradients.
+typedef struct EpochStats {
+    int epoch; // Starting from 1
+    int num_epoch;
+    int steps; // Number of parameter updates made
+    long samples; // Number of samples trained on
+
+    double wall_seconds; // Total time of the epoch, including the phases below and anything between them
+    double forward_seconds;
+    double backward_seconds;
+    double optimizer_seconds;
+    double loss_seconds; // Time spent calculating the loss and its derivative
+    double samples_per_second;
+
+    // Mean loss over the epoch's samples, as calculated by each batch's training step before its update.
+    double loss;
+
+    size_t bytes_allocated; // Memory held for training: workspaces and optimizer state
+
+    // Buffers allocated during the epoch (see aligned_buffer.h), and how many of those were not served by the
+    // buffer pool. Once training has set itself up in the first epoch, both are expected to stay at 0.
+    size_t buffer_allocations;
+    size_t system_allocations;
+
+    int num_layers;
+    const LayerStats* layers; // Per-layer times, or NULL if they were not recorded
+} EpochStats;
+
+typedef enum TelemetryFormat {
+    TELEMETRY_CSV,
+    TELEMETRY_JSON // One JSON object per line
+} TelemetryFormat;
+
+// Returns the current time of a monotonic wall clock, in seconds.
+double wall_time_seconds();
+
+// Writes the statistics of an epoch to a log file as a single line. For CSV, a header line is written before
+// the first epoch's line. Per-layer times are written as extra columns (CSV) or a "layers" array (JSON).
+void write_epoch_stats(FILE* file, TelemetryFormat format, const EpochStats* stats);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,22 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+typedef struct ThreadPool ThreadPool; // Opaque, defined in thread_pool.c
+
+// A task run by every worker of a thread pool, given the worker's index (from 0 to the number of workers - 1).
+typedef void (*ThreadPoolTask)(void* arg, int worker_index);
+
+// Creates a pool of num_threads workers. The calling thread acts as worker 0, so num_threads - 1 threads are
+// started, and they persist (sleeping between tasks) until the pool is freed.
+ThreadPool* create_thread_pool(int num_threads);
+
+// Runs the task once on every worker, including the calling thread, and waits for all of them to finish.
+void run_on_thread_pool(ThreadPool* pool, ThreadPoolTask task, void* arg);
+
+// Returns the number of workers in the pool, including the calling thread.
+int thread_pool_size(const ThreadPool* pool);
+
+// Stops and joins the pool's threads, then frees the pool.
+void free_thread_pool(ThreadPool* pool);
+
+#endif
\ No newline at end of file
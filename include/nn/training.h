@@ -1,16 +1,56 @@
 #ifndef TRAINING_H
 #define TRAINING_H
 
+#include "nn/telemetry.h" // For EpochStats and TelemetryFormat
+
 // Forward declerations
 typedef struct Network Network;
 typedef struct Matrix Matrix;
 typedef struct LossFunc LossFunc;
 typedef struct LearningRateSchedule LearningRateSchedule;
+typedef struct Optimizer Optimizer;
+
+// Called with the statistics of each epoch once it has finished. user_data is the pointer given in the
+// TrainingMonitor.
+typedef void (*TrainingCallback)(const EpochStats* stats, void* user_data);
+
+// Where the statistics of each epoch of training are delivered.
+typedef struct TrainingMonitor {
+    TrainingCallback callback; // Called after every epoch, or NULL
+    void* user_data;
+    int per_layer; // Whether the time spent on each layer is recorded, which adds a little overhead per layer
+    FILE* log; // If not NULL, every epoch's statistics are also written to this file as one line
+    TelemetryFormat log_format;
+} TrainingMonitor;
+
+typedef struct TrainingOptions {
+    int batch_size; // Number of samples used for each parameter update, or 0 for full-batch training
+    int shuffle; // Whether the order of the samples is shuffled at the start of each epoch
+    int num_threads; // Number of threads each batch is split across, including the calling thread
+    int lean_memory; // Whether activations and their derivatives are computed in place (see set_workspace_memory)
+    int checkpoint_interval; // If greater than 1, only every this many layers' outputs are kept for backprop
+} TrainingOptions;
+
+// Trains the network using mini-batch gradient descent, with each update made by the given optimizer, whose
+// state is reset at the start of training. Each batch is a view of consecutive columns of the
+// dataset rather than a copy. If shuffling is enabled, the columns of input and expected_output are permuted
+// in place (together) at the start of each epoch. With more than one thread, the samples of each batch are
+// split across a thread pool, and the gradients of each worker are summed in a fixed order, so that training
+// is deterministic for a given number of threads. The statistics of every epoch are delivered to the monitor.
+void training_loop(Network* net, int num_epoch, Matrix* input, Matrix* expected_output, 
+    const LossFunc* loss_func, const LearningRateSchedule* lr_schedule, const Optimizer* optimizer,
+    const TrainingOptions* options, const TrainingMonitor* monitor);
 
-typedef void (*TrainingReport)(int, int, double);
+// Performs a single training step on one batch: a forward pass, the backward pass, and an update of every
+// layer's parameters by the optimizer, whose state must already have been initialised (see optimizer.h). step
+// is the number of updates made since then, including this one. Returns the loss over the batch before the
+// update, which is calculated alongside its derivative.
+double train_step(Network* net, const Matrix* input, const Matrix* expected_output, const LossFunc* loss_func,
+    const Optimizer* optimizer, double learning_rate, int step);
 
-void training_loop(Network* net, int num_epoch, const Matrix* input, const Matrix* expected_output, 
-    const LossFunc* loss_func, const LearningRateSchedule* lr_schedule, TrainingReport report_progress,
-    int report_freq);
+// Returns the loss of the network over a whole dataset, running inference over batches of up to batch_size
+// samples (or over the whole dataset at once if batch_size is 0).
+double calc_dataset_loss(const Network* net, const Matrix* input, const Matrix* expected_output,
+    const LossFunc* loss_func, int batch_size);
 
 #endif
\ No newline at end of file
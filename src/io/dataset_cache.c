@@ -0,0 +1,226 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "io/dataset_cache.h"
+#include "io/dataset_loader.h"
+#include "maths/matrix.h"
+
+#define CACHE_MAGIC "NNDATSET"
+#define CACHE_VERSION 2
+
+// Blocks start on a multiple of the largest page size in common use, so that they can be mapped on any system.
+#define CACHE_BLOCK_ALIGNMENT 65536
+
+// Written in native byte order, so a cache from a machine with a different byte order is detected as stale.
+#define CACHE_BYTE_ORDER_MARK 0x01020304u
+
+typedef struct DatasetCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order_mark;
+    uint32_t scalar_size; // sizeof(Scalar) of the build that wrote the cache
+    uint32_t num_inputs;
+    uint32_t num_outputs;
+    uint32_t num_samples;
+
+    // Size and modification time of the .csv when the cache was written, used to detect stale caches.
+    uint64_t source_size;
+    int64_t source_mtime_sec;
+    int64_t source_mtime_nsec;
+
+    uint64_t input_offset;
+    uint64_t output_offset;
+} DatasetCacheHeader;
+
+static char* cache_path_for(const char* csv_path) {
+    // Returns the path of the cache for a .csv dataset, which the caller must free.
+    size_t length = strlen(csv_path);
+    char* path = malloc(length + 5);
+    if (path != NULL) {
+        memcpy(path, csv_path, length);
+        memcpy(path + length, ".bin", 5);
+    }
+    return path;
+}
+
+static uint64_t aligned_offset(uint64_t offset) {
+    return (offset + CACHE_BLOCK_ALIGNMENT - 1) / CACHE_BLOCK_ALIGNMENT * CACHE_BLOCK_ALIGNMENT;
+}
+
+static int write_matrix_block(FILE* file, uint64_t offset, const Matrix* matrix) {
+    // Writes the columns of a matrix contiguously, starting from the given offset. Columns of a row-major matrix
+    // are gathered into a buffer first.
+    if (fseek(file, (long)offset, SEEK_SET) != 0) {
+        return 0;
+    }
+    if (matrix->layout == MATRIX_COL_MAJOR) {
+        for (int col_count=0; col_count < matrix->cols; col_count++) {
+            const Scalar* col = &matrix->data[(size_t)col_count * matrix->stride];
+            if (fwrite(col, sizeof(Scalar), matrix->rows, file) != (size_t)matrix->rows) {
+                return 0;
+            }
+        }
+        return 1;
+    }
+
+    Scalar* col = malloc(((size_t)matrix->rows + 1) * sizeof(Scalar));
+    int written = (col != NULL);
+    for (int col_count=0; col_count < matrix->cols && written; col_count++) {
+        for (int row_count=0; row_count < matrix->rows; row_count++) {
+            col[row_count] = get_element(matrix, row_count, col_count);
+        }
+        written = (fwrite(col, sizeof(Scalar), matrix->rows, file) == (size_t)matrix->rows);
+    }
+    free(col);
+    return written;
+}
+
+int write_dataset_cache(const char* csv_path, const Matrix* input, const Matrix* expected_output) {
+    struct stat source_info;
+    if (stat(csv_path, &source_info) != 0) {
+        return 0;
+    }
+
+    DatasetCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.version = CACHE_VERSION;
+    header.byte_order_mark = CACHE_BYTE_ORDER_MARK;
+    header.scalar_size = sizeof(Scalar);
+    header.num_inputs = input->rows;
+    header.num_outputs = expected_output->rows;
+    header.num_samples = input->cols;
+    header.source_size = source_info.st_size;
+    header.source_mtime_sec = source_info.st_mtim.tv_sec;
+    header.source_mtime_nsec = source_info.st_mtim.tv_nsec;
+
+    uint64_t input_bytes = (uint64_t)input->rows * input->cols * sizeof(Scalar);
+    header.input_offset = aligned_offset(sizeof(header));
+    header.output_offset = aligned_offset(header.input_offset + input_bytes);
+
+    char* cache_path = cache_path_for(csv_path);
+    if (cache_path == NULL) {
+        return 0;
+    }
+    char* temp_path = malloc(strlen(cache_path) + 32);
+    if (temp_path == NULL) {
+        free(cache_path);
+        return 0;
+    }
+    sprintf(temp_path, "%s.tmp%ld", cache_path, (long)getpid());
+
+    // The gaps before each block are left unwritten, so take no space on file systems with sparse files.
+    FILE* file = fopen(temp_path, "wb");
+    int written = file != NULL && fwrite(&header, sizeof(header), 1, file) == 1 &&
+        write_matrix_block(file, header.input_offset, input) &&
+        write_matrix_block(file, header.output_offset, expected_output);
+    if (file != NULL && fclose(file) != 0) {
+        written = 0;
+    }
+
+    if (written) {
+        written = (rename(temp_path, cache_path) == 0);
+    }
+    if (!written) {
+        remove(temp_path);
+    }
+
+    free(temp_path);
+    free(cache_path);
+    return written;
+}
+
+static uint64_t block_bytes(uint32_t rows, uint32_t cols) {
+    return (uint64_t)rows * cols * sizeof(Scalar);
+}
+
+static int block_in_file(uint64_t offset, uint32_t rows, uint32_t cols, uint64_t file_size) {
+    // Whether a matrix block lies entirely within the file, and is aligned as it was written.
+    return offset % CACHE_BLOCK_ALIGNMENT == 0 && offset <= file_size && block_bytes(rows, cols) <= file_size - offset;
+}
+
+static int map_matrix_block(int fd, uint64_t offset, int rows, int cols, Matrix* matrix) {
+    // Maps a block of the cache as a matrix, privately so that writes to it stay in memory. Returns 0 if the
+    // mapping failed, and 1 otherwise.
+    if (rows == 0 || cols == 0) {
+        *matrix = create_matrix_with_layout(rows, cols, MATRIX_COL_MAJOR);
+        return 1;
+    }
+
+    size_t bytes = (size_t)rows * cols * sizeof(Scalar);
+    void* data = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, (off_t)offset);
+    if (data == MAP_FAILED) {
+        return 0;
+    }
+
+    *matrix = matrix_mapped(data, rows, cols, MATRIX_COL_MAJOR);
+    return 1;
+}
+
+int load_dataset_cache(const char* csv_path, Matrix* input, Matrix* expected_output) {
+    struct stat source_info, cache_info;
+    char* cache_path = cache_path_for(csv_path);
+    if (cache_path == NULL || stat(csv_path, &source_info) != 0) {
+        free(cache_path);
+        return 0;
+    }
+
+    int fd = open(cache_path, O_RDONLY);
+    free(cache_path);
+    if (fd < 0) {
+        return 0;
+    }
+
+    // The cache is only used if it was made from the current version of the .csv, by a compatible build, and
+    // its blocks are aligned, lie within the file after the header, and do not overlap each other.
+    DatasetCacheHeader header;
+    int valid = fstat(fd, &cache_info) == 0 && read(fd, &header, sizeof(header)) == (ssize_t)sizeof(header) &&
+        memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) == 0 && header.version == CACHE_VERSION &&
+        header.byte_order_mark == CACHE_BYTE_ORDER_MARK && header.scalar_size == sizeof(Scalar) &&
+        header.source_size == (uint64_t)source_info.st_size &&
+        header.source_mtime_sec == source_info.st_mtim.tv_sec &&
+        header.source_mtime_nsec == source_info.st_mtim.tv_nsec &&
+        header.num_samples <= INT32_MAX && header.num_inputs <= INT32_MAX && header.num_outputs <= INT32_MAX &&
+        header.input_offset >= sizeof(header) &&
+        block_in_file(header.input_offset, header.num_inputs, header.num_samples, cache_info.st_size) &&
+        block_in_file(header.output_offset, header.num_outputs, header.num_samples, cache_info.st_size) &&
+        header.input_offset + block_bytes(header.num_inputs, header.num_samples) <= header.output_offset;
+
+    Matrix mapped_input = empty_matrix(), mapped_output = empty_matrix();
+    if (valid) {
+        valid = map_matrix_block(fd, header.input_offset, header.num_inputs, header.num_samples, &mapped_input) &&
+            map_matrix_block(fd, header.output_offset, header.num_outputs, header.num_samples, &mapped_output);
+    }
+    close(fd); // Mappings stay valid after the file is closed
+
+    if (!valid) {
+        free_matrix(&mapped_input);
+        free_matrix(&mapped_output);
+        return 0;
+    }
+
+    *input = mapped_input;
+    *expected_output = mapped_output;
+    return 1;
+}
+
+int convert_dataset_to_cache(const char* csv_path) {
+    Matrix input, expected_output;
+    if (!parse_csv_dataset(csv_path, &input, &expected_output)) {
+        return 0;
+    }
+
+    int written = write_dataset_cache(csv_path, &input, &expected_output);
+    if (!written) {
+        printf("Error writing dataset cache for %s\n", csv_path);
+    }
+
+    free_matrix(&input);
+    free_matrix(&expected_output);
+    return written;
+}
\ No newline at end of file
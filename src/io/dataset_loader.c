@@ -1,76 +1,415 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "io/dataset_loader.h"
+#include "io/dataset_cache.h"
 #include "maths/matrix.h"
+#include "nn/thread_pool.h"
 
-static void get_dataset_dimensions(FILE* file, int* inputs_out, int* outputs_out, int* rows_out) {
-    char line[4096];
+// Files are split into chunks of at least this many bytes, which are parsed in parallel.
+#define MIN_CHUNK_BYTES (16 * 1024 * 1024)
 
-    fgets(line, 4096, file);
-    // Reading comment in first row to determine the number of input and output parameters
-    if (sscanf(line, "# INPUTS: %d, OUTPUTS: %d", inputs_out, outputs_out) != 2) {
-        printf("Error retrieving the number of input and output parameters from dataset\n");
+// Number of rows a chunk's buffer initially has space for, which is doubled whenever it fills up.
+#define INITIAL_CHUNK_ROWS 1024
+
+// Powers of ten that are exactly representable as doubles, used by the fast path of parse_number.
+static const double exact_powers_of_ten[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+// A range of whole lines of the file, and the values parsed from it, stored row by row.
+typedef struct ParseChunk {
+    const char* start;
+    const char* end;
+
+    Scalar* values;
+    size_t capacity; // Number of rows values has space for
+    int num_rows;
+    int first_sample; // Index of the chunk's first row within the whole dataset
+    int malformed_rows; // Rows with fewer values than expected, whose missing values are left as 0
+    int failed; // Set if the values buffer could not be grown
+} ParseChunk;
+
+typedef struct ParseJob {
+    ParseChunk* chunks;
+    int values_per_row;
+    Matrix* input;
+    Matrix* expected_output;
+} ParseJob;
+
+static double power_of_ten(int exponent) {
+    // Returns 10^exponent, exactly if it is representable.
+    if (exponent >= 0 && exponent <= 22) {
+        return exact_powers_of_ten[exponent];
     }
 
-    fgets(line, 4096, file); // Skipping header row
+    double result = 1.0;
+    double base = (exponent < 0) ? 0.1 : 10.0;
+    for (int i=0; i < abs(exponent); i++) {
+        result *= base;
+    }
+    return result;
+}
 
-    int rows_count=0;
-    while (fgets(line, 4096, file) != NULL) { 
-        rows_count++;
+static const char* parse_number(const char* p, const char* end, double* result) {
+    // Parses a decimal number, such as -12.5 or 3e-4, starting at p, and returns a pointer to the first
+    // character after it, or NULL if there is no number at p. Unlike strtod and atof, this does not depend on
+    // the locale (the decimal point is always '.'), and does not need the text to be null-terminated.
+    int negative = 0;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
     }
 
-    *rows_out = rows_count;
+    // Up to 19 significant digits fit in the mantissa; any further digits only shift the decimal exponent.
+    unsigned long long mantissa = 0;
+    int num_digits = 0;
+    int exponent = 0;
+    int seen_digit = 0;
 
-    rewind(file); 
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+        seen_digit = 1;
+        if (num_digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            num_digits += (mantissa != 0);
+        }
+        else {
+            exponent++;
+        }
+    }
+
+    if (p < end && *p == '.') {
+        p++;
+        for (; p < end && *p >= '0' && *p <= '9'; p++) {
+            seen_digit = 1;
+            if (num_digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                num_digits += (mantissa != 0);
+                exponent--;
+            }
+        }
+    }
+
+    if (!seen_digit) {
+        return NULL;
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* exponent_start = p;
+        p++;
+        int exponent_negative = 0;
+        if (p < end && (*p == '-' || *p == '+')) {
+            exponent_negative = (*p == '-');
+            p++;
+        }
+
+        if (p < end && *p >= '0' && *p <= '9') {
+            int explicit_exponent = 0;
+            for (; p < end && *p >= '0' && *p <= '9'; p++) {
+                if (explicit_exponent < 10000) {
+                    explicit_exponent = explicit_exponent * 10 + (*p - '0');
+                }
+            }
+            exponent += exponent_negative ? -explicit_exponent : explicit_exponent;
+        }
+        else {
+            p = exponent_start; // An 'e' without digits is not part of the number
+        }
+    }
+
+    // When both the mantissa and the power of ten are exactly representable, a single multiplication or
+    // division gives the correctly rounded result. Longer mantissas (such as the 17 significant digits needed
+    // to round-trip a double) are exact in long double, which has a 64-bit significand, as are powers of ten
+    // up to 10^27, so the result is rounded once there and then to double. Anything else is rare in datasets,
+    // and is computed to within a few units in the last place.
+    double value;
+    if (mantissa < (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+        value = (double)mantissa;
+        value = (exponent < 0) ? value / exact_powers_of_ten[-exponent] : value * exact_powers_of_ten[exponent];
+    }
+    else if (exponent >= -27 && exponent <= 27) {
+        long double power = 1.0L;
+        for (int i=0; i < abs(exponent); i++) {
+            power *= 10.0L;
+        }
+        long double wide_value = (long double)mantissa;
+        value = (double)((exponent < 0) ? wide_value / power : wide_value * power);
+    }
+    else {
+        value = (double)mantissa;
+        value = (exponent < 0) ? value / power_of_ten(-exponent) : value * power_of_ten(exponent);
+    }
+
+    *result = negative ? -value : value;
+    return p;
 }
 
-static void fill_matrices_from_dataset(FILE* file, Matrix* input, Matrix* expected_output) {
-    char line[4096];
+static const char* skip_line(const char* p, const char* end) {
+    // Returns a pointer to the start of the next line, or end if p is on the last line.
+    const char* newline = memchr(p, '\n', end - p);
+    return (newline == NULL) ? end : newline + 1;
+}
+
+static int is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static Scalar* reserve_chunk_row(ParseChunk* chunk, int values_per_row) {
+    // Returns space for one more row at the end of the chunk's values, doubling the buffer if it is full.
+    if ((size_t)chunk->num_rows == chunk->capacity) {
+        size_t new_capacity = (chunk->capacity == 0) ? INITIAL_CHUNK_ROWS : chunk->capacity * 2;
+        Scalar* new_values = realloc(chunk->values, new_capacity * values_per_row * sizeof(Scalar));
+        if (new_values == NULL) {
+            return NULL;
+        }
+        chunk->values = new_values;
+        chunk->capacity = new_capacity;
+    }
+    return &chunk->values[(size_t)chunk->num_rows * values_per_row];
+}
+
+static void parse_chunk(void* arg, int worker_index) {
+    // Parses each line of a chunk into a row of values. Blank lines are skipped, and values past the expected
+    // number in a row are ignored.
+    ParseJob* job = arg;
+    ParseChunk* chunk = &job->chunks[worker_index];
+    const char* p = chunk->start;
+    const char* end = chunk->end;
+
+    while (p < end) {
+        const char* line_end = memchr(p, '\n', end - p);
+        if (line_end == NULL) {
+            line_end = end;
+        }
+
+        const char* q = p;
+        while (q < line_end && is_blank(*q)) {
+            q++;
+        }
+        if (q == line_end) {
+            p = skip_line(p, end);
+            continue;
+        }
 
-    // Skipping first and second lines as they are comments and headers respectively.
-    fgets(line, 4096, file);
-    fgets(line, 4096, file);
+        Scalar* row = reserve_chunk_row(chunk, job->values_per_row);
+        if (row == NULL) {
+            chunk->failed = 1;
+            return;
+        }
+
+        int num_values = 0;
+        while (num_values < job->values_per_row) {
+            while (q < line_end && is_blank(*q)) {
+                q++;
+            }
 
-    int sample_index = 0;
-    while (fgets(line, 4096, file) != NULL) {
-        char* token = strtok(line, ",");
-        // Filling the input matrix.
-        for (int feature_index=0; feature_index < input->rows; feature_index++) {
-            if (!token) {
+            double value;
+            const char* after = parse_number(q, line_end, &value);
+            if (after == NULL) {
                 break;
             }
-            set_element(input, feature_index, sample_index, atof(token));
-            token = strtok(NULL, ","); 
-        }
+            row[num_values++] = value;
 
-        // Filling the output matrix.
-        for (int output_index=0; output_index < expected_output->rows; output_index++) {
-            if (!token) {
+            q = after;
+            while (q < line_end && is_blank(*q)) {
+                q++;
+            }
+            if (q == line_end || *q != ',') {
                 break;
             }
-            set_element(expected_output, output_index, sample_index, atof(token));
-            token = strtok(NULL, ","); 
+            q++;
+        }
+
+        if (num_values < job->values_per_row) {
+            memset(&row[num_values], 0, (job->values_per_row - num_values) * sizeof(Scalar));
+            chunk->malformed_rows++;
         }
 
-        sample_index++;
+        chunk->num_rows++;
+        p = skip_line(line_end, end);
     }
 }
 
-void load_dataset_to_matrices(const char* file_path, Matrix* input, Matrix* expected_output) {
-    FILE* file = fopen(file_path, "r");
-    if (!file) {
+static void scatter_chunk(void* arg, int worker_index) {
+    // Copies each row of a chunk's values into the column of the input and expected output matrices for its
+    // sample. The matrices are column-major, so each copy is contiguous. Chunks cover disjoint ranges of
+    // samples, so can be scattered in parallel.
+    ParseJob* job = arg;
+    const ParseChunk* chunk = &job->chunks[worker_index];
+    int num_inputs = job->input->rows;
+    int num_outputs = job->expected_output->rows;
+
+    for (int r=0; r < chunk->num_rows; r++) {
+        const Scalar* row = &chunk->values[(size_t)r * job->values_per_row];
+        int sample = chunk->first_sample + r;
+
+        memcpy(&job->input->data[(size_t)sample * job->input->stride], row, num_inputs * sizeof(Scalar));
+        memcpy(&job->expected_output->data[(size_t)sample * job->expected_output->stride], &row[num_inputs],
+            num_outputs * sizeof(Scalar));
+    }
+}
+
+static int count_chunks(size_t bytes) {
+    // Uses one chunk per MIN_CHUNK_BYTES of data, up to the number of processors available.
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t chunks = bytes / MIN_CHUNK_BYTES + 1;
+    if (processors > 0 && chunks > (size_t)processors) {
+        chunks = processors;
+    }
+    return (int)chunks;
+}
+
+static int parse_dataset(const char* data, size_t size, Matrix* input, Matrix* expected_output) {
+    // Parses a mapped .csv dataset into the input and expected output matrices. Returns 0 if the dataset could
+    // not be parsed, and 1 otherwise.
+    const char* end = data + size;
+
+    // Reading comment in first row to determine the number of input and output parameters
+    char first_line[256];
+    const char* header_end = skip_line(data, end);
+    size_t first_line_length = header_end - data;
+    if (first_line_length >= sizeof(first_line)) {
+        first_line_length = sizeof(first_line) - 1;
+    }
+    memcpy(first_line, data, first_line_length);
+    first_line[first_line_length] = '\0';
+
+    int num_inputs, num_outputs;
+    if (sscanf(first_line, "# INPUTS: %d, OUTPUTS: %d", &num_inputs, &num_outputs) != 2 || num_inputs < 0 ||
+        num_outputs < 0) {
+        printf("Error retrieving the number of input and output parameters from dataset\n");
+        return 0;
+    }
+
+    const char* rows_start = skip_line(header_end, end); // Skipping header row
+
+    // Splitting the rows into chunks at line boundaries, so that no line is split between two chunks.
+    int num_chunks = count_chunks(end - rows_start);
+    ParseChunk* chunks = calloc(num_chunks, sizeof(ParseChunk));
+    if (chunks == NULL) {
+        printf("Memory allocation failed\n");
+        return 0;
+    }
+
+    const char* chunk_start = rows_start;
+    for (int i=0; i < num_chunks; i++) {
+        const char* chunk_end = end;
+        if (i < num_chunks - 1) {
+            chunk_end = rows_start + (size_t)(end - rows_start) * (i + 1) / num_chunks;
+            chunk_end = (chunk_end < chunk_start) ? chunk_start : skip_line(chunk_end, end);
+        }
+        chunks[i].start = chunk_start;
+        chunks[i].end = chunk_end;
+        chunk_start = chunk_end;
+    }
+
+    ParseJob job = {chunks, num_inputs + num_outputs, input, expected_output};
+    ThreadPool* pool = (num_chunks > 1) ? create_thread_pool(num_chunks) : NULL;
+    if (pool != NULL && thread_pool_size(pool) < num_chunks) {
+        free_thread_pool(pool);
+        pool = NULL;
+    }
+
+    // Each chunk is parsed on its own worker, or all of them in turn if there are no workers.
+    if (pool != NULL) {
+        run_on_thread_pool(pool, &parse_chunk, &job);
+    }
+    else {
+        for (int i=0; i < num_chunks; i++) {
+            parse_chunk(&job, i);
+        }
+    }
+
+    int num_samples = 0, malformed_rows = 0, failed = 0;
+    for (int i=0; i < num_chunks; i++) {
+        chunks[i].first_sample = num_samples;
+        num_samples += chunks[i].num_rows;
+        malformed_rows += chunks[i].malformed_rows;
+        failed |= chunks[i].failed;
+    }
+
+    if (failed) {
+        printf("Memory allocation failed\n");
+    }
+    else {
+        if (malformed_rows > 0) {
+            printf("Warning: %d rows of dataset had missing values, which were set to 0\n", malformed_rows);
+        }
+
+        *input = create_matrix_with_layout(num_inputs, num_samples, MATRIX_COL_MAJOR);
+        *expected_output = create_matrix_with_layout(num_outputs, num_samples, MATRIX_COL_MAJOR);
+
+        // Either matrix failing to allocate leaves the dataset empty, rather than scattering into NULL.
+        if (num_samples > 0 && (input->data == NULL || expected_output->data == NULL)) {
+            printf("Memory allocation failed\n");
+            free_matrix(input);
+            free_matrix(expected_output);
+            failed = 1;
+        }
+        else if (pool != NULL) {
+            run_on_thread_pool(pool, &scatter_chunk, &job);
+        }
+        else {
+            for (int i=0; i < num_chunks; i++) {
+                scatter_chunk(&job, i);
+            }
+        }
+    }
+
+    free_thread_pool(pool);
+    for (int i=0; i < num_chunks; i++) {
+        free(chunks[i].values);
+    }
+    free(chunks);
+
+    return !failed;
+}
+
+int parse_csv_dataset(const char* file_path, Matrix* input, Matrix* expected_output) {
+    *input = empty_matrix();
+    *expected_output = empty_matrix();
+
+    int fd = open(file_path, O_RDONLY);
+    if (fd < 0) {
         printf("Error opening dataset file\n");
-        return;
+        return 0;
     }
 
-    int input_rows, output_rows, samples_count;
-    get_dataset_dimensions(file, &input_rows, &output_rows, &samples_count);
+    // The file is mapped rather than read, so it is parsed in a single pass straight from the page cache.
+    struct stat file_info;
+    if (fstat(fd, &file_info) != 0 || file_info.st_size == 0) {
+        printf("Error reading dataset file\n");
+        close(fd);
+        return 0;
+    }
 
-    *input = create_matrix(input_rows, samples_count);
-    *expected_output = create_matrix(output_rows, samples_count);
+    size_t size = file_info.st_size;
+    const char* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        printf("Error reading dataset file\n");
+        return 0;
+    }
+    madvise((void*)data, size, MADV_SEQUENTIAL);
 
-    fill_matrices_from_dataset(file, input, expected_output);
+    int parsed = parse_dataset(data, size, input, expected_output);
 
-    fclose(file);
+    munmap((void*)data, size);
+    return parsed;
+}
+
+void load_dataset_to_matrices(const char* file_path, Matrix* input, Matrix* expected_output) {
+    // A cache that is up to date with the .csv is mapped instead of parsing the .csv. Otherwise, the .csv is
+    // parsed and a cache written for next time; failing to write it (e.g. in a read-only directory) only means
+    // the .csv will be parsed again.
+    if (load_dataset_cache(file_path, input, expected_output)) {
+        return;
+    }
+
+    if (parse_csv_dataset(file_path, input, expected_output)) {
+        write_dataset_cache(file_path, input, expected_output);
+    }
 }
\ No newline at end of file
@@ -23,6 +23,11 @@ char* read_file(const char* file_path) {
     return buffer;
 }
 
+int has_param(const char* data, const char* param_name) {
+    // Returns 1 if param_name occurs in the data, and 0 otherwise. Used for optional parameters.
+    return strstr(data, param_name) != NULL;
+}
+
 int extract_int(const char* data, const char* param_name) {
     // Finds first occurance of param_name, and returns the value following it as an integer.
     char* pos = strstr(data, param_name); 
@@ -37,6 +42,17 @@ double extract_double(const char* data, const char* param_name) {
     return atof(pos+1); 
 }
 
+int extract_bool(const char* data, const char* param_name) {
+    // Finds first occurance of param_name, and returns 1 if the value following it is true, or 0 otherwise.
+    char* pos = strstr(data, param_name);
+    pos = strchr(pos, ':');
+    pos++;
+    while (*pos == ' ') {
+        pos++;
+    }
+    return strncmp(pos, "true", 4) == 0;
+}
+
 char* extract_string(const char* data, const char* param_name) {
     // Finds first occurance of param_name, and returns the value of the string following it.
     char* pos = strstr(data, param_name);
@@ -4,12 +4,18 @@
 // Reads a file, and returns the file contents as a string.
 char* read_file(const char* file_path);
 
+// Returns 1 if param_name occurs in the data, and 0 otherwise. Used for optional parameters.
+int has_param(const char* data, const char* param_name);
+
 // Finds first occurance of param_name, and returns the value following it as an integer.
 int extract_int(const char* data, const char* param_name);
 
 // Finds first occurance of param_name, and returns the value following it as an double.
 double extract_double(const char* data, const char* param_name);
 
+// Finds first occurance of param_name, and returns 1 if the value following it is true, or 0 otherwise.
+int extract_bool(const char* data, const char* param_name);
+
 // Finds first occurance of param_name, and returns the value of the string following it.
 char* extract_string(const char* data, const char* param_name);
 
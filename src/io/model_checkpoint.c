@@ -0,0 +1,338 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "io/model_checkpoint.h"
+#include "nn/neural_network.h"
+#include "nn/weight_init.h"
+#include "maths/matrix.h"
+#include "maths/activation.h"
+#include "maths/softmax.h"
+
+#define CHECKPOINT_MAGIC "NNMODEL"
+#define CHECKPOINT_VERSION 1
+
+// Weight and bias blocks start on a cache line boundary, so mapped matrices are as aligned as allocated ones.
+#define CHECKPOINT_BLOCK_ALIGNMENT 64
+
+// Written in native byte order, so a checkpoint from a machine with a different byte order is rejected.
+#define CHECKPOINT_BYTE_ORDER_MARK 0x01020304u
+
+// Identifiers stored for each layer's activation function and weight initialisation. These are part of the
+// file format, so existing values must never change.
+enum {ACTIVATION_ID_SIGMOID = 1, ACTIVATION_ID_TANH = 2, ACTIVATION_ID_RELU = 3, ACTIVATION_ID_SOFTMAX = 4};
+enum {WEIGHT_INIT_ID_NONE = 0, WEIGHT_INIT_ID_XAVIER = 1, WEIGHT_INIT_ID_HE = 2};
+
+typedef struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order_mark;
+    uint32_t scalar_size; // sizeof(Scalar) of the build that saved the checkpoint
+    uint32_t num_layers;
+    uint32_t input_nodes;
+    uint32_t math_accuracy; // MathAccuracy of the network, which was reserved (and so 0, MATH_EXACT) before
+} CheckpointHeader;
+
+// One per layer, directly after the header.
+typedef struct CheckpointLayer {
+    uint32_t num_nodes;
+    uint32_t activation_id;
+    uint32_t weight_init_id;
+    uint32_t reserved;
+    uint64_t weights_offset; // Offsets from the start of the file
+    uint64_t biases_offset;
+} CheckpointLayer;
+
+static uint32_t activation_to_id(const ActivationFunc* activation) {
+    if (activation == &sigmoid) {
+        return ACTIVATION_ID_SIGMOID;
+    }
+    if (activation == &tanh_custom) {
+        return ACTIVATION_ID_TANH;
+    }
+    if (activation == &ReLu) {
+        return ACTIVATION_ID_RELU;
+    }
+    if (activation == &softmax) {
+        return ACTIVATION_ID_SOFTMAX;
+    }
+    return 0;
+}
+
+static const ActivationFunc* id_to_activation(uint32_t id) {
+    switch (id) {
+        case ACTIVATION_ID_SIGMOID:
+            return &sigmoid;
+
+        case ACTIVATION_ID_TANH:
+            return &tanh_custom;
+
+        case ACTIVATION_ID_RELU:
+            return &ReLu;
+
+        case ACTIVATION_ID_SOFTMAX:
+            return &softmax;
+
+        default:
+            return NULL;
+    }
+}
+
+static uint32_t weight_init_to_id(WeightInit weight_init) {
+    if (weight_init == Xavier) {
+        return WEIGHT_INIT_ID_XAVIER;
+    }
+    if (weight_init == He) {
+        return WEIGHT_INIT_ID_HE;
+    }
+    return WEIGHT_INIT_ID_NONE;
+}
+
+static WeightInit id_to_weight_init(uint32_t id) {
+    if (id == WEIGHT_INIT_ID_XAVIER) {
+        return Xavier;
+    }
+    if (id == WEIGHT_INIT_ID_HE) {
+        return He;
+    }
+    return NULL;
+}
+
+static uint64_t aligned_offset(uint64_t offset) {
+    return (offset + CHECKPOINT_BLOCK_ALIGNMENT - 1) / CHECKPOINT_BLOCK_ALIGNMENT * CHECKPOINT_BLOCK_ALIGNMENT;
+}
+
+static uint64_t matrix_bytes(int rows, int cols) {
+    return (uint64_t)rows * cols * sizeof(Scalar);
+}
+
+static int write_matrix_block(FILE* file, uint64_t* position, uint64_t offset, const Matrix* matrix) {
+    // Pads the file with zeros up to the given offset, then writes the rows of a matrix contiguously.
+    static const char padding[CHECKPOINT_BLOCK_ALIGNMENT] = {0};
+    if (offset - *position > 0 && fwrite(padding, 1, offset - *position, file) != offset - *position) {
+        return 0;
+    }
+
+    for (int row_count=0; row_count < matrix->rows; row_count++) {
+        const Scalar* row = &matrix->data[(size_t)row_count * matrix->stride];
+        if (fwrite(row, sizeof(Scalar), matrix->cols, file) != (size_t)matrix->cols) {
+            return 0;
+        }
+    }
+
+    *position = offset + matrix_bytes(matrix->rows, matrix->cols);
+    return 1;
+}
+
+int save_network(const Network* net, const char* file_path) {
+    if (net->num_layers <= 0) {
+        printf("Cannot save a network with no layers\n");
+        return 0;
+    }
+
+    CheckpointHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    header.version = CHECKPOINT_VERSION;
+    header.byte_order_mark = CHECKPOINT_BYTE_ORDER_MARK;
+    header.scalar_size = sizeof(Scalar);
+    header.num_layers = net->num_layers;
+    header.input_nodes = net->layers[0].weights.cols;
+    header.math_accuracy = net->math_accuracy;
+
+    CheckpointLayer* layer_table = calloc((size_t)net->num_layers, sizeof(CheckpointLayer));
+    if (layer_table == NULL) {
+        printf("Memory allocation failed\n");
+        return 0;
+    }
+
+    // Laying out the blocks: every layer's weights then biases, in order, after the layer table.
+    uint64_t next_offset = sizeof(header) + (uint64_t)net->num_layers * sizeof(CheckpointLayer);
+    for (int i=0; i < net->num_layers; i++) {
+        const Layer* layer = &net->layers[i];
+        layer_table[i].num_nodes = layer->num_nodes;
+        layer_table[i].activation_id = activation_to_id(layer->activation);
+        layer_table[i].weight_init_id = weight_init_to_id(layer->weight_init);
+
+        layer_table[i].weights_offset = aligned_offset(next_offset);
+        next_offset = layer_table[i].weights_offset + matrix_bytes(layer->weights.rows, layer->weights.cols);
+        layer_table[i].biases_offset = aligned_offset(next_offset);
+        next_offset = layer_table[i].biases_offset + matrix_bytes(layer->biases.rows, layer->biases.cols);
+    }
+
+    char* temp_path = malloc(strlen(file_path) + 32);
+    if (temp_path == NULL) {
+        printf("Memory allocation failed\n");
+        free(layer_table);
+        return 0;
+    }
+    sprintf(temp_path, "%s.tmp%ld", file_path, (long)getpid());
+
+    FILE* file = fopen(temp_path, "wb");
+    uint64_t position = sizeof(header) + (uint64_t)net->num_layers * sizeof(CheckpointLayer);
+    int written = file != NULL && fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(layer_table, sizeof(CheckpointLayer), net->num_layers, file) == (size_t)net->num_layers;
+
+    for (int i=0; written && i < net->num_layers; i++) {
+        written = write_matrix_block(file, &position, layer_table[i].weights_offset, &net->layers[i].weights) &&
+            write_matrix_block(file, &position, layer_table[i].biases_offset, &net->layers[i].biases);
+    }
+
+    if (file != NULL && fclose(file) != 0) {
+        written = 0;
+    }
+    if (written) {
+        written = (rename(temp_path, file_path) == 0);
+    }
+    if (!written) {
+        printf("Error writing checkpoint file\n");
+        remove(temp_path);
+    }
+
+    free(temp_path);
+    free(layer_table);
+    return written;
+}
+
+static Network empty_network() {
+    Network empty;
+    memset(&empty, 0, sizeof(empty));
+    return empty;
+}
+
+static int block_in_file(uint64_t offset, int rows, int cols, uint64_t file_size) {
+    // Whether a matrix block lies entirely within the file, and is aligned as it was saved.
+    return offset % CHECKPOINT_BLOCK_ALIGNMENT == 0 && offset <= file_size &&
+        matrix_bytes(rows, cols) <= file_size - offset;
+}
+
+static int validate_checkpoint(const char* data, uint64_t size) {
+    // Checks that a mapped file is a checkpoint this build can load, and that every layer's dimensions and
+    // blocks are consistent with the file. Returns 0 if it is not, and 1 otherwise.
+    const CheckpointHeader* header = (const CheckpointHeader*)data;
+    if (size < sizeof(CheckpointHeader) || memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0 ||
+        header->byte_order_mark != CHECKPOINT_BYTE_ORDER_MARK || header->version != CHECKPOINT_VERSION) {
+        printf("Not a supported checkpoint file\n");
+        return 0;
+    }
+    if (header->scalar_size != sizeof(Scalar)) {
+        printf("Checkpoint was saved by a build with %u-byte values, but this build uses %u-byte values\n",
+            header->scalar_size, (unsigned)sizeof(Scalar));
+        return 0;
+    }
+    if (header->num_layers == 0 || header->num_layers > INT32_MAX ||
+        (size - sizeof(CheckpointHeader)) / sizeof(CheckpointLayer) < header->num_layers) {
+        printf("Checkpoint file is corrupt\n");
+        return 0;
+    }
+
+    const CheckpointLayer* layer_table = (const CheckpointLayer*)(data + sizeof(CheckpointHeader));
+    uint32_t input_size = header->input_nodes;
+    for (uint32_t i=0; i < header->num_layers; i++) {
+        const CheckpointLayer* layer = &layer_table[i];
+        if (layer->num_nodes == 0 || layer->num_nodes > INT32_MAX || input_size > INT32_MAX ||
+            id_to_activation(layer->activation_id) == NULL ||
+            !block_in_file(layer->weights_offset, layer->num_nodes, input_size, size) ||
+            !block_in_file(layer->biases_offset, layer->num_nodes, 1, size)) {
+            printf("Checkpoint file is corrupt\n");
+            return 0;
+        }
+        input_size = layer->num_nodes;
+    }
+
+    return 1;
+}
+
+Network load_network(const char* file_path, CheckpointLoadMode mode) {
+    int fd = open(file_path, O_RDONLY);
+    if (fd < 0) {
+        printf("Error opening checkpoint file\n");
+        return empty_network();
+    }
+
+    // The file is mapped in both modes: copies are made straight from the mapping, which is then released.
+    // Shared mappings of a file are backed by the same page cache pages in every process.
+    struct stat file_info;
+    if (fstat(fd, &file_info) != 0 || file_info.st_size == 0) {
+        printf("Error reading checkpoint file\n");
+        close(fd);
+        return empty_network();
+    }
+    uint64_t size = file_info.st_size;
+    char* data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        printf("Error reading checkpoint file\n");
+        return empty_network();
+    }
+
+    if (!validate_checkpoint(data, size)) {
+        munmap(data, size);
+        return empty_network();
+    }
+
+    const CheckpointHeader* header = (const CheckpointHeader*)data;
+    const CheckpointLayer* layer_table = (const CheckpointLayer*)(data + sizeof(CheckpointHeader));
+
+    Network net = empty_network();
+    net.layers = calloc(header->num_layers, sizeof(Layer));
+    if (net.layers == NULL) {
+        printf("Memory allocation failed\n");
+        munmap(data, size);
+        return empty_network();
+    }
+    net.num_layers = header->num_layers;
+    net.math_accuracy = (header->math_accuracy == MATH_FAST) ? MATH_FAST : MATH_EXACT;
+
+    int input_size = header->input_nodes;
+    for (int i=0; i < net.num_layers; i++) {
+        Layer* layer = &net.layers[i];
+        int num_nodes = layer_table[i].num_nodes;
+        layer->num_nodes = num_nodes;
+        layer->activation = id_to_activation(layer_table[i].activation_id);
+        layer->weight_init = id_to_weight_init(layer_table[i].weight_init_id);
+
+        // Mapped weights are only ever read, so casting away the mapping's read-only protection is safe as
+        // long as the network is not trained.
+        Matrix saved_weights = matrix_view((Scalar*)(data + layer_table[i].weights_offset), num_nodes, input_size);
+        Matrix saved_biases = matrix_view((Scalar*)(data + layer_table[i].biases_offset), num_nodes, 1);
+        if (mode == CHECKPOINT_MAP) {
+            layer->weights = saved_weights;
+            layer->biases = saved_biases;
+        }
+        else {
+            layer->weights = copy_matrix(&saved_weights);
+            layer->biases = copy_matrix(&saved_biases);
+        }
+
+        // Workspace matrices are created when the workspace is first reserved.
+        layer->z = empty_matrix();
+        layer->a = empty_matrix();
+        layer->dL_da = empty_matrix();
+        layer->dL_dz = empty_matrix();
+        layer->dL_dw = empty_matrix();
+        layer->dL_db = empty_matrix();
+
+        // Checkpoints do not store optimizer state, so training a loaded network starts it afresh.
+        layer->weights_moment1 = empty_matrix();
+        layer->weights_moment2 = empty_matrix();
+        layer->biases_moment1 = empty_matrix();
+        layer->biases_moment2 = empty_matrix();
+
+        input_size = num_nodes;
+    }
+
+    if (mode == CHECKPOINT_MAP) {
+        net.checkpoint_mapping = data;
+        net.checkpoint_mapping_bytes = size;
+    }
+    else {
+        munmap(data, size);
+    }
+
+    return net;
+}
\ No newline at end of file
@@ -69,9 +69,9 @@ Network build_network_from_config(const char* file_path) {
     WeightInit weight_init_fns[num_layers];
 
     for (int i=0; i < num_layers; i++) {
-        int curr_layer_size;
-        const ActivationFunc* curr_activation_func;
-        WeightInit weight_init_fn;
+        int curr_layer_size = 0;
+        const ActivationFunc* curr_activation_func = NULL;
+        WeightInit weight_init_fn = NULL;
         extract_layer(file_data, i, &curr_layer_size, &curr_activation_func, &weight_init_fn);
 
         layer_sizes[i] = curr_layer_size;
@@ -79,7 +79,33 @@ Network build_network_from_config(const char* file_path) {
         weight_init_fns[i] = weight_init_fn;
     }
 
+    // The maximum batch size is optional: if it is not given, the workspace is instead allocated for the
+    // size of the first batch the network is run on.
+    int max_batch_size = 0;
+    if (has_param(file_data, "\"max_batch_size\"")) {
+        max_batch_size = extract_int(file_data, "\"max_batch_size\"");
+    }
+
+    // The accuracy of the activations and softmax is also optional, and is exact unless "FAST" is given.
+    MathAccuracy math_accuracy = MATH_EXACT;
+    if (has_param(file_data, "\"math_accuracy\"")) {
+        char* accuracy_str = extract_string(file_data, "\"math_accuracy\"");
+        if (strcmp(accuracy_str, "FAST") == 0) {
+            math_accuracy = MATH_FAST;
+        }
+        else if (strcmp(accuracy_str, "EXACT") != 0) {
+            printf("Unknown math_accuracy \"%s\", using EXACT\n", accuracy_str);
+        }
+        free(accuracy_str);
+    }
+
     free(file_data);
 
-    return init_neural_net(num_layers, input_nodes, layer_sizes, activations, weight_init_fns);
+    Network net = init_neural_net(num_layers, input_nodes, layer_sizes, activations, weight_init_fns);
+    net.math_accuracy = math_accuracy;
+    if (max_batch_size > 0) {
+        reserve_workspace(&net, max_batch_size);
+    }
+
+    return net;
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "io/json_config_parser_priv.h"
 #include "nn/training.h"
 #include "nn/lr_schedule.h"
+#include "nn/optimizer.h"
 #include "maths/loss.h"
 
 static StepDecay extract_step_decay_param(const char* data) {
@@ -20,8 +21,46 @@ static ExpDecay extract_exp_decay_param(const char* data) {
     return result;
 }
 
+static MomentumParams extract_momentum_param(const char* data) {
+    MomentumParams result;
+    result.momentum = has_param(data, "\"momentum\"") ? extract_double(data, "\"momentum\"") : 0.9;
+    return result;
+}
+
+static AdamParams extract_adam_param(const char* data) {
+    // Each parameter is optional, defaulting to the values suggested by the authors of Adam.
+    AdamParams result;
+    result.beta1 = has_param(data, "\"beta1\"") ? extract_double(data, "\"beta1\"") : 0.9;
+    result.beta2 = has_param(data, "\"beta2\"") ? extract_double(data, "\"beta2\"") : 0.999;
+    result.epsilon = has_param(data, "\"epsilon\"") ? extract_double(data, "\"epsilon\"") : 1e-8;
+    return result;
+}
+
+static void extract_optimizer(const char* data, Optimizer* optimizer) {
+    // The optimizer is optional, defaulting to plain gradient descent.
+    optimizer->type = SGD;
+    if (!has_param(data, "\"optimizer\"")) {
+        return;
+    }
+
+    char* optimizer_str = extract_string(data, "\"optimizer\"");
+    if (strcmp(optimizer_str, "MOMENTUM") == 0) {
+        optimizer->type = MOMENTUM;
+        optimizer->param.momentum = extract_momentum_param(data);
+    }
+    else if (strcmp(optimizer_str, "NESTEROV") == 0) {
+        optimizer->type = NESTEROV;
+        optimizer->param.momentum = extract_momentum_param(data);
+    }
+    else if (strcmp(optimizer_str, "ADAM") == 0) {
+        optimizer->type = ADAM;
+        optimizer->param.adam = extract_adam_param(data);
+    }
+    free(optimizer_str);
+}
+
 void extract_training_parameters(const char* file_path, const LossFunc** loss_func, int* num_epoch, 
-    LearningRateSchedule* lr_schedule) {
+    LearningRateSchedule* lr_schedule, Optimizer* optimizer, TrainingOptions* options) {
     // Extracts training parameters from a train_config.json file
 
     char* file_data = read_file(file_path);
@@ -58,5 +97,49 @@ void extract_training_parameters(const char* file_path, const LossFunc** loss_fu
     }
     free(lr_schedule_type_str);
 
+    extract_optimizer(file_data, optimizer);
+
+    // Batching parameters are optional, defaulting to full-batch training without shuffling.
+    options->batch_size = 0;
+    options->shuffle = 0;
+    if (has_param(file_data, "\"batch_size\"")) {
+        options->batch_size = extract_int(file_data, "\"batch_size\"");
+    }
+    if (has_param(file_data, "\"shuffle\"")) {
+        options->shuffle = extract_bool(file_data, "\"shuffle\"");
+    }
+
+    // Training is single-threaded unless a number of threads is set, either in the config or by the
+    // NN_NUM_THREADS environment variable, which takes precedence so it can be changed per machine.
+    options->num_threads = 1;
+    if (has_param(file_data, "\"num_threads\"")) {
+        options->num_threads = extract_int(file_data, "\"num_threads\"");
+    }
+    const char* env_threads = getenv("NN_NUM_THREADS");
+    if (env_threads != NULL && atoi(env_threads) > 0) {
+        options->num_threads = atoi(env_threads);
+    }
+    if (options->num_threads < 1) {
+        options->num_threads = 1;
+    }
+
+    // Intermediates are stored in full unless "memory" is "LEAN", and every layer's output is kept unless a
+    // checkpoint interval is given.
+    options->lean_memory = 0;
+    if (has_param(file_data, "\"memory\"")) {
+        char* memory_str = extract_string(file_data, "\"memory\"");
+        if (strcmp(memory_str, "LEAN") == 0) {
+            options->lean_memory = 1;
+        }
+        else if (strcmp(memory_str, "STANDARD") != 0) {
+            printf("Unknown memory \"%s\", using STANDARD\n", memory_str);
+        }
+        free(memory_str);
+    }
+    options->checkpoint_interval = 0;
+    if (has_param(file_data, "\"checkpoint_interval\"")) {
+        options->checkpoint_interval = extract_int(file_data, "\"checkpoint_interval\"");
+    }
+
     free(file_data);
 }
\ No newline at end of file
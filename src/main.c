@@ -1,54 +1,135 @@
 #include <stdio.h>
 #include <string.h>
-#include <time.h>
+#include <stdlib.h>
 #include "io/net_config_loader.h"
 #include "io/train_config_loader.h"
 #include "io/dataset_loader.h"
+#include "io/model_checkpoint.h"
+#include "io/dataset_cache.h"
 #include "nn/neural_network.h"
 #include "nn/training.h"
 #include "nn/lr_schedule.h"
+#include "nn/optimizer.h"
 #include "nn/evaluation.h"
+#include "nn/telemetry.h"
 #include "maths/matrix.h"
+#include "maths/aligned_buffer.h"
 #include "maths/loss.h"
 
 void report_progress(int current_epoch, int epochs, double loss_val) {
     printf("[Epoch %d / %d] Loss: %f\n", current_epoch, epochs, loss_val);
 }
 
+// Progress of training: how often the loss is reported, and the time spent in each phase of training, summed
+// over every epoch.
+typedef struct TrainingProgress {
+    int report_freq;
+    double forward_seconds;
+    double backward_seconds;
+    double optimizer_seconds;
+    double loss_seconds;
+    long samples;
+    size_t buffer_allocations;
+    size_t later_system_allocations; // Those from the system allocator after the first epoch
+} TrainingProgress;
+
+static void report_epoch_stats(const EpochStats* stats, void* user_data) {
+    // Reports the loss every report_freq epochs and after the last, and adds the epoch's phase times onto the
+    // totals.
+    TrainingProgress* totals = user_data;
+    totals->forward_seconds += stats->forward_seconds;
+    totals->backward_seconds += stats->backward_seconds;
+    totals->optimizer_seconds += stats->optimizer_seconds;
+    totals->loss_seconds += stats->loss_seconds;
+    totals->samples += stats->samples;
+    totals->buffer_allocations += stats->buffer_allocations;
+    if (stats->epoch > 1) {
+        totals->later_system_allocations += stats->system_allocations;
+    }
+
+    if (stats->epoch % totals->report_freq == 0 || stats->epoch == stats->num_epoch) {
+        report_progress(stats->epoch, stats->num_epoch, stats->loss);
+    }
+}
+
+static FILE* open_telemetry_log(TelemetryFormat* format) {
+    // Training statistics are logged if the NN_TELEMETRY_LOG environment variable names a file, as CSV if its
+    // name ends in .csv and as JSON lines otherwise. Returns NULL if there is no log.
+    const char* log_path = getenv("NN_TELEMETRY_LOG");
+    if (log_path == NULL || log_path[0] == '\0') {
+        return NULL;
+    }
+
+    size_t length = strlen(log_path);
+    *format = (length >= 4 && strcmp(log_path + length - 4, ".csv") == 0) ? TELEMETRY_CSV : TELEMETRY_JSON;
+
+    FILE* log = fopen(log_path, "w");
+    if (log == NULL) {
+        printf("Error opening telemetry log %s\n", log_path);
+    }
+    return log;
+}
+
 static void load_data_paths(const char* dataset_name, char* net_config_path, char* train_config_path, 
-    char* train_dataset_path, char* test_dataset_path) {
+    char* train_dataset_path, char* test_dataset_path, char* model_path) {
     sprintf(net_config_path, "data/%s/net_config.json", dataset_name);
     sprintf(train_config_path, "data/%s/train_config.json", dataset_name);
     sprintf(train_dataset_path, "data/%s/train.csv", dataset_name);
     sprintf(test_dataset_path, "data/%s/test.csv", dataset_name);
+    sprintf(model_path, "data/%s/model.bin", dataset_name);
 }
 
 static void train_neural_net(Network* net, const char* train_dataset_path, LearningRateSchedule* lr_schedule,
-    const LossFunc* loss_func, int num_epoch) {
+    const Optimizer* optimizer, const LossFunc* loss_func, int num_epoch, const TrainingOptions* options) {
     // Loads training dataset, trains network, and reports on duration and accuracy.
     
     Matrix input, expected_output;
     load_dataset_to_matrices(train_dataset_path, &input, &expected_output);
+
+    // The workspace needs to hold one batch, which for full-batch training is the whole training dataset.
+    int batch_size = input.cols;
+    if (options->batch_size > 0 && options->batch_size < input.cols) {
+        batch_size = options->batch_size;
+    }
+    set_workspace_memory(net, options->lean_memory, options->checkpoint_interval);
+    reserve_workspace(net, batch_size);
+    printf("Precision: %s, workspace size: %.1f KiB (%.1f KiB without sharing between intermediates)\n",
+        SCALAR_NAME, workspace_bytes(net) / 1024.0, unplanned_workspace_bytes(net) / 1024.0);
+    if (options->num_threads > 1) {
+        printf("Training threads: %d\n", options->num_threads);
+    }
     
-    Matrix untrained_output = forward_pass(net, &input);
-    double untrained_loss = loss_func->func_ptr(&expected_output, &untrained_output);
+    double untrained_loss = calc_dataset_loss(net, &input, &expected_output, loss_func, batch_size);
     report_progress(0, num_epoch, untrained_loss);
-    free_matrix(&untrained_output);
 
-    int report_freq = (num_epoch >= 5) ? num_epoch / 5 : 1;
+    TrainingProgress totals = {0};
+    totals.report_freq = (num_epoch >= 5) ? num_epoch / 5 : 1;
+    TrainingMonitor monitor = {&report_epoch_stats, &totals, 0, NULL, TELEMETRY_JSON};
+    monitor.log = open_telemetry_log(&monitor.log_format);
+    const char* per_layer = getenv("NN_TELEMETRY_PER_LAYER");
+    monitor.per_layer = (per_layer != NULL && atoi(per_layer) != 0);
 
-    time_t train_start = clock();
+    // Training may run on several threads, so is timed by wall-clock time rather than processor time.
+    double train_start = wall_time_seconds();
 
-    training_loop(net, num_epoch, &input, &expected_output, loss_func, lr_schedule, &report_progress, 
-        report_freq);
+    training_loop(net, num_epoch, &input, &expected_output, loss_func, lr_schedule, optimizer, options, &monitor);
 
-    time_t train_end = clock();
+    double train_duration = wall_time_seconds() - train_start;
+    if (monitor.log != NULL) {
+        fclose(monitor.log);
+    }
 
-    double train_duration = (double)(train_end - train_start) / CLOCKS_PER_SEC;
-    printf("Training completed in %.3fs.\n", train_duration);
+    printf("Training completed in %.3fs (%.0f samples/s).\n", train_duration,
+        (train_duration > 0) ? totals.samples / train_duration : 0.0);
+    printf("Forward: %.3fs, backward: %.3fs, optimizer: %.3fs, loss: %.3fs\n", totals.forward_seconds,
+        totals.backward_seconds, totals.optimizer_seconds, totals.loss_seconds);
+    BufferStats buffers = buffer_stats();
+    printf("Buffer allocations: %zu in training (%zu from the system after the first epoch), peak %.1f KiB in use, "
+        "pool hit rate %.1f%%\n", totals.buffer_allocations, totals.later_system_allocations,
+        buffers.peak_bytes_in_use / 1024.0, pool_hit_rate(&buffers) * 100);
 
     if (loss_func == &BCE || loss_func == &CCE) { // Classification problems
-        Matrix fully_trained_output = forward_pass(net, &input);
+        Matrix fully_trained_output = predict(net, &input);
         double accuracy = calc_accuracy(&fully_trained_output, &expected_output);
         printf("Final accuracy on training dataset: %.2f%%\n", accuracy*100);
         free_matrix(&fully_trained_output);
@@ -59,19 +140,17 @@ static void train_neural_net(Network* net, const char* train_dataset_path, Learn
     free_matrix(&expected_output);
 }
 
-static void test_neural_net(Network* net, const char* test_dataset_path, const LossFunc* loss_func) {
+static void test_neural_net(const Network* net, const char* test_dataset_path, const LossFunc* loss_func) {
     // Loads testing dataset, runs the trained network on this data, and reports on duration and accuracy.
 
     Matrix input, expected_output;
     load_dataset_to_matrices(test_dataset_path, &input, &expected_output);
 
-    time_t test_start = clock();
-
-    Matrix test_output = forward_pass(net, &input);
+    double test_start = wall_time_seconds();
 
-    time_t test_end = clock();
+    Matrix test_output = predict(net, &input);
 
-    double test_duration = (double)(test_end - test_start) / CLOCKS_PER_SEC;
+    double test_duration = wall_time_seconds() - test_start;
     printf("Testing completed in %.3fs.\n", test_duration);
 
     double loss = loss_func->func_ptr(&expected_output, &test_output);
@@ -87,15 +166,40 @@ static void test_neural_net(Network* net, const char* test_dataset_path, const L
     free_matrix(&test_output);
 }
 
-int main() {
+static int convert_datasets(const char* dataset_name, const char* train_dataset_path,
+    const char* test_dataset_path) {
+    // Writes the binary caches of a dataset's training and testing .csv files, without training anything.
+    int converted = convert_dataset_to_cache(train_dataset_path) && convert_dataset_to_cache(test_dataset_path);
+    if (converted) {
+        printf("Dataset caches written for %s\n", dataset_name);
+    }
+    return converted;
+}
+
+int main(int argc, char* argv[]) {
+    // Usage: main [--convert DATASET]
+    // With --convert, the named dataset's .csv files are converted to their binary caches, and nothing is
+    // trained. Otherwise, the dataset to train on is read from standard input.
     char dataset_name[32];
-    printf("Enter a dataset name (e.g. xor, iris): ");
-    scanf("%s", dataset_name);
-    printf("\n");
+    int convert_only = (argc == 3 && strcmp(argv[1], "--convert") == 0);
+    if (convert_only) {
+        snprintf(dataset_name, sizeof(dataset_name), "%s", argv[2]);
+    }
+    else if (argc > 1) {
+        printf("Usage: %s [--convert DATASET]\n", argv[0]);
+        return 1;
+    }
+    else {
+        printf("Enter a dataset name (e.g. xor, iris): ");
+        scanf("%31s", dataset_name);
+        printf("\n");
+    }
 
     char net_config_path[128], train_config_path[128], train_dataset_path[128], test_dataset_path[128];
+    char model_path[128];
 
-    load_data_paths(dataset_name, net_config_path, train_config_path, train_dataset_path, test_dataset_path);
+    load_data_paths(dataset_name, net_config_path, train_config_path, train_dataset_path, test_dataset_path,
+        model_path);
 
     // Verifying that the entered dataset is valid.
     FILE* existence_check = fopen(net_config_path, "r");
@@ -105,23 +209,38 @@ int main() {
     }
     fclose(existence_check);
 
+    if (convert_only) {
+        return convert_datasets(dataset_name, train_dataset_path, test_dataset_path) ? 0 : 1;
+    }
+
     // Creating the network 
     Network neural_net = build_network_from_config(net_config_path);
 
     LearningRateSchedule lr_schedule;
+    Optimizer optimizer;
+    TrainingOptions training_options;
     const LossFunc* loss_func;
     int num_epoch;
 
-    extract_training_parameters(train_config_path, &loss_func, &num_epoch, &lr_schedule);
+    extract_training_parameters(train_config_path, &loss_func, &num_epoch, &lr_schedule, &optimizer,
+        &training_options);
 
     printf("---Training---\n");
-    train_neural_net(&neural_net, train_dataset_path, &lr_schedule, loss_func, num_epoch);
+    train_neural_net(&neural_net, train_dataset_path, &lr_schedule, &optimizer, loss_func, num_epoch, &training_options);
 
+    // The trained network is saved, and then tested as loaded back from the checkpoint, the same way a
+    // separate inference process would load it.
     printf("---Testing---\n");
-    test_neural_net(&neural_net, test_dataset_path, loss_func);
+    Network saved_net = {0};
+    if (save_network(&neural_net, model_path)) {
+        printf("Model saved to %s\n", model_path);
+        saved_net = load_network(model_path, CHECKPOINT_MAP);
+    }
+    test_neural_net((saved_net.num_layers > 0) ? &saved_net : &neural_net, test_dataset_path, loss_func);
 
     // Freeing allocated memory.
     free_network(&neural_net);
+    free_network(&saved_net);
 
     return 0;
 }
\ No newline at end of file
@@ -1,20 +1,22 @@
-#include <math.h>
+#include <tgmath.h> // exp resolves to the variant for the Scalar type
 #include "maths/activation.h"
+#include "maths/simd.h"
 
 // Custom included in tanh name to prevent conflict with tanh function in math.h
-const ActivationFunc sigmoid = {&sigmoid_func, &sigmoid_derivative};
-const ActivationFunc tanh_custom = {&tanh_func, &tanh_derivative};
-const ActivationFunc ReLu = {&ReLu_func, &ReLu_derivative};
+const ActivationFunc sigmoid = {&sigmoid_func, &sigmoid_derivative, &sigmoid_apply, &sigmoid_fast_apply,
+    &sigmoid_backward};
+const ActivationFunc tanh_custom = {&tanh_func, &tanh_derivative, &tanh_apply, &tanh_fast_apply, &tanh_backward};
+const ActivationFunc ReLu = {&ReLu_func, &ReLu_derivative, &ReLu_apply, &ReLu_apply, &ReLu_backward};
 
-double sigmoid_func(double x) {
-    return (1.0 / (1.0 + exp(-x)));
+Scalar sigmoid_func(Scalar x) {
+    return (1 / (1 + exp(-x)));
 }
 
-double sigmoid_derivative(double x) {
-    return (sigmoid_func(x) * (1.0 - sigmoid_func(x)));
+Scalar sigmoid_derivative(Scalar x) {
+    return (sigmoid_func(x) * (1 - sigmoid_func(x)));
 }
 
-double tanh_func(double x) {
+Scalar tanh_func(Scalar x) {
     // For large magnitudes of x, return the value tanh(x) tends to for the sign of x to prevent overflow
     // with large exponents.
     if (x > 10.0) {
@@ -27,21 +29,61 @@ double tanh_func(double x) {
     return ((exp(x) - exp(-x)) / (exp(x) + exp(-x)));
 }
 
-double tanh_derivative(double x) {
-    return (1.0 - (tanh_func(x) * tanh_func(x)));
+Scalar tanh_derivative(Scalar x) {
+    return (1 - (tanh_func(x) * tanh_func(x)));
 }
 
-double ReLu_func(double x) {
+Scalar ReLu_func(Scalar x) {
     if (x > 0.0) {
         return x;
     }
     return 0;
 }
 
-double ReLu_derivative(double x) {
+Scalar ReLu_derivative(Scalar x) {
     // Note that ReLu's derivative is technically undefined at x = 0, but is taken as being 0 here.
     if (x > 0.0) {
         return 1.0;
     }
     return 0.0;
+}
+
+// The array-at-a-time forms of sigmoid and tanh inline the scalar functions, so give the same results as them.
+// The others are run by the element-wise SIMD kernels, as they need no transcendental functions.
+
+void sigmoid_apply(const Scalar* in, Scalar* out, int n) {
+    for (int i=0; i < n; i++) {
+        out[i] = 1 / (1 + exp(-in[i]));
+    }
+}
+
+void tanh_apply(const Scalar* in, Scalar* out, int n) {
+    for (int i=0; i < n; i++) {
+        Scalar x = in[i];
+        out[i] = (x > 10.0) ? 1.0 : (x < -10.0) ? -1.0 : ((exp(x) - exp(-x)) / (exp(x) + exp(-x)));
+    }
+}
+
+void ReLu_apply(const Scalar* in, Scalar* out, int n) {
+    get_simd_kernels()->relu(in, out, n);
+}
+
+void sigmoid_fast_apply(const Scalar* in, Scalar* out, int n) {
+    get_simd_kernels()->fast_sigmoid(in, out, n);
+}
+
+void tanh_fast_apply(const Scalar* in, Scalar* out, int n) {
+    get_simd_kernels()->fast_tanh(in, out, n);
+}
+
+void sigmoid_backward(const Scalar* a, const Scalar* dL_da, Scalar* dL_dz, int n) {
+    get_simd_kernels()->sigmoid_backward(a, dL_da, dL_dz, n);
+}
+
+void tanh_backward(const Scalar* a, const Scalar* dL_da, Scalar* dL_dz, int n) {
+    get_simd_kernels()->tanh_backward(a, dL_da, dL_dz, n);
+}
+
+void ReLu_backward(const Scalar* a, const Scalar* dL_da, Scalar* dL_dz, int n) {
+    get_simd_kernels()->relu_backward(a, dL_da, dL_dz, n);
 }
\ No newline at end of file
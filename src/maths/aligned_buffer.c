@@ -0,0 +1,301 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "maths/aligned_buffer.h"
+
+// Number of size classes of up to MAX_POOLED_BYTES: classes of 1 to 4 cache lines, then four per doubling.
+#define NUM_SIZE_CLASSES 76
+
+// Most free buffers of each size class that a thread caches for itself before returning them to the shared
+// pool.
+#define THREAD_CACHE_LIMIT 8
+
+// Every buffer is preceded by a header recording how to free it. The header takes a whole cache line, so the
+// buffer after it stays aligned.
+typedef struct BufferHeader {
+    struct BufferHeader* next; // Next buffer in the same free list, while the buffer is free
+    size_t capacity; // Usable bytes after the header
+    int size_class; // Or -1 for buffers that are not pooled
+} BufferHeader;
+
+typedef struct FreeLists {
+    BufferHeader* heads[NUM_SIZE_CLASSES];
+    int counts[NUM_SIZE_CLASSES];
+} FreeLists;
+
+static int use_huge_pages = 0;
+static int use_pool = 0;
+
+static FreeLists shared_pool;
+static pthread_mutex_t shared_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Each thread's cache is flushed into the shared pool when the thread exits, by the destructor of a thread key.
+static _Thread_local FreeLists thread_cache;
+static _Thread_local int thread_cache_registered = 0;
+static pthread_key_t thread_cache_key;
+static pthread_once_t thread_cache_key_once = PTHREAD_ONCE_INIT;
+
+static atomic_size_t allocation_count;
+static atomic_size_t pool_hit_count;
+static atomic_size_t system_allocation_count;
+static atomic_size_t free_count;
+static atomic_size_t bytes_in_use;
+static atomic_size_t peak_bytes_in_use;
+static atomic_size_t bytes_pooled;
+
+static int read_switch(const char* name) {
+    // Reads an environment variable that is either 0 or 1, where unset means 0.
+    const char* setting = getenv(name);
+    if (setting == NULL || strcmp(setting, "0") == 0) {
+        return 0;
+    }
+    if (strcmp(setting, "1") == 0) {
+        return 1;
+    }
+    printf("Unknown %s \"%s\", expected 0 or 1\n", name, setting);
+    return 0;
+}
+
+__attribute__((constructor))
+static void read_buffer_settings() {
+    // Read once at startup, like NN_SIMD_LEVEL, so every allocation in a run makes the same choices.
+    use_pool = read_switch("NN_MATRIX_POOL");
+
+    if (read_switch("NN_HUGE_PAGES")) {
+#ifdef MADV_HUGEPAGE
+        use_huge_pages = 1;
+#else
+        printf("Transparent huge pages are not supported on this system, NN_HUGE_PAGES is ignored\n");
+#endif
+    }
+}
+
+int huge_pages_enabled() {
+    return use_huge_pages;
+}
+
+int buffer_pool_enabled() {
+    return use_pool;
+}
+
+static size_t round_up(size_t bytes, size_t multiple) {
+    return (bytes + multiple - 1) / multiple * multiple;
+}
+
+static size_t class_lines(int size_class) {
+    // Size of a class in cache lines: 1 to 4, then four evenly spaced sizes up to each doubling (5 to 8, 10 to
+    // 16, 20 to 32, ...), so no more than a quarter of a pooled buffer goes unused.
+    if (size_class < 4) {
+        return size_class + 1;
+    }
+    size_t base = (size_t)4 << ((size_class - 4) / 4);
+    return base + base / 4 * ((size_class - 4) % 4 + 1);
+}
+
+static int size_class_of(size_t lines) {
+    // Smallest size class holding at least the given number of cache lines (at least 1).
+    if (lines <= 4) {
+        return (int)lines - 1;
+    }
+    int doubling = (63 - __builtin_clzll(lines - 1)) - 2; // So that 4 << doubling < lines <= 8 << doubling
+    size_t base = (size_t)4 << doubling;
+    size_t step = base / 4;
+    return 4 + 4 * doubling + (int)((lines - base + step - 1) / step) - 1;
+}
+
+static BufferHeader* pop_free(FreeLists* lists, int size_class) {
+    BufferHeader* header = lists->heads[size_class];
+    if (header != NULL) {
+        lists->heads[size_class] = header->next;
+        lists->counts[size_class]--;
+    }
+    return header;
+}
+
+static void push_free(FreeLists* lists, BufferHeader* header) {
+    header->next = lists->heads[header->size_class];
+    lists->heads[header->size_class] = header;
+    lists->counts[header->size_class]++;
+}
+
+static void flush_thread_cache(void* cache) {
+    // Hands the buffers of an exiting thread's cache to the shared pool, for other threads to reuse.
+    FreeLists* lists = cache;
+    pthread_mutex_lock(&shared_pool_lock);
+    for (int size_class=0; size_class < NUM_SIZE_CLASSES; size_class++) {
+        BufferHeader* header;
+        while ((header = pop_free(lists, size_class)) != NULL) {
+            push_free(&shared_pool, header);
+        }
+    }
+    pthread_mutex_unlock(&shared_pool_lock);
+}
+
+static void create_thread_cache_key() {
+    pthread_key_create(&thread_cache_key, flush_thread_cache);
+}
+
+static void register_thread_cache() {
+    // Thread key destructors only run for keys with a value, so each thread sets its cache as the value before
+    // caching its first buffer.
+    if (!thread_cache_registered) {
+        pthread_once(&thread_cache_key_once, create_thread_cache_key);
+        pthread_setspecific(thread_cache_key, &thread_cache);
+        thread_cache_registered = 1;
+    }
+}
+
+static BufferHeader* system_alloc(size_t capacity, int size_class) {
+    // Gets a new buffer, with its header, from the system allocator. capacity is a multiple of BUFFER_ALIGNMENT,
+    // as aligned_alloc requires the size to be a multiple of the alignment.
+    size_t total = capacity + BUFFER_ALIGNMENT;
+    BufferHeader* header = NULL;
+
+#ifdef MADV_HUGEPAGE
+    if (use_huge_pages && total >= HUGE_PAGE_SIZE) {
+        size_t rounded = round_up(total, HUGE_PAGE_SIZE);
+        header = aligned_alloc(HUGE_PAGE_SIZE, rounded);
+        if (header != NULL) {
+            // Only advice, so the buffer is still usable (with normal pages) if the kernel declines it.
+            madvise(header, rounded, MADV_HUGEPAGE);
+        }
+    }
+#endif
+
+    if (header == NULL) {
+        header = aligned_alloc(BUFFER_ALIGNMENT, total);
+        if (header == NULL) {
+            return NULL;
+        }
+    }
+
+    header->next = NULL;
+    header->capacity = capacity;
+    header->size_class = size_class;
+    atomic_fetch_add_explicit(&system_allocation_count, 1, memory_order_relaxed);
+    return header;
+}
+
+static BufferHeader* take_pooled(int size_class) {
+    // Takes a free buffer of a size class from the thread's cache, or failing that from the shared pool.
+    // Returns NULL if neither has one.
+    BufferHeader* header = pop_free(&thread_cache, size_class);
+    if (header == NULL) {
+        pthread_mutex_lock(&shared_pool_lock);
+        header = pop_free(&shared_pool, size_class);
+        pthread_mutex_unlock(&shared_pool_lock);
+    }
+
+    if (header != NULL) {
+        atomic_fetch_add_explicit(&pool_hit_count, 1, memory_order_relaxed);
+        atomic_fetch_sub_explicit(&bytes_pooled, header->capacity, memory_order_relaxed);
+    }
+    return header;
+}
+
+static void count_allocation(size_t capacity) {
+    atomic_fetch_add_explicit(&allocation_count, 1, memory_order_relaxed);
+    size_t in_use = atomic_fetch_add_explicit(&bytes_in_use, capacity, memory_order_relaxed) + capacity;
+
+    size_t peak = atomic_load_explicit(&peak_bytes_in_use, memory_order_relaxed);
+    while (in_use > peak && !atomic_compare_exchange_weak_explicit(&peak_bytes_in_use, &peak, in_use,
+        memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+void* alloc_aligned(size_t bytes) {
+    // A zero-byte request is rounded up to one cache line so that success always gives a non-NULL buffer.
+    size_t lines = (bytes == 0) ? 1 : round_up(bytes, BUFFER_ALIGNMENT) / BUFFER_ALIGNMENT;
+
+    BufferHeader* header;
+    if (use_pool && lines * BUFFER_ALIGNMENT <= MAX_POOLED_BYTES) {
+        int size_class = size_class_of(lines);
+        header = take_pooled(size_class);
+        if (header == NULL) {
+            header = system_alloc(class_lines(size_class) * BUFFER_ALIGNMENT, size_class);
+        }
+    }
+    else {
+        header = system_alloc(lines * BUFFER_ALIGNMENT, -1);
+    }
+
+    if (header == NULL) {
+        return NULL;
+    }
+    count_allocation(header->capacity);
+    return (char*)header + BUFFER_ALIGNMENT;
+}
+
+void* alloc_aligned_zeroed(size_t bytes) {
+    // Pooled buffers hold whatever their last user left in them, so are always cleared here, rather than
+    // relying on calloc.
+    void* buffer = alloc_aligned(bytes);
+    if (buffer != NULL) {
+        memset(buffer, 0, bytes);
+    }
+    return buffer;
+}
+
+void free_aligned(void* buffer) {
+    if (buffer == NULL) {
+        return;
+    }
+
+    BufferHeader* header = (BufferHeader*)((char*)buffer - BUFFER_ALIGNMENT);
+    atomic_fetch_add_explicit(&free_count, 1, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&bytes_in_use, header->capacity, memory_order_relaxed);
+
+    if (header->size_class < 0) {
+        free(header);
+        return;
+    }
+
+    // Pooled buffers go to the freeing thread's cache, whichever thread allocated them, until it is full.
+    atomic_fetch_add_explicit(&bytes_pooled, header->capacity, memory_order_relaxed);
+    register_thread_cache();
+    if (thread_cache.counts[header->size_class] < THREAD_CACHE_LIMIT) {
+        push_free(&thread_cache, header);
+    }
+    else {
+        pthread_mutex_lock(&shared_pool_lock);
+        push_free(&shared_pool, header);
+        pthread_mutex_unlock(&shared_pool_lock);
+    }
+}
+
+static void free_all(FreeLists* lists) {
+    for (int size_class=0; size_class < NUM_SIZE_CLASSES; size_class++) {
+        BufferHeader* header;
+        while ((header = pop_free(lists, size_class)) != NULL) {
+            atomic_fetch_sub_explicit(&bytes_pooled, header->capacity, memory_order_relaxed);
+            free(header);
+        }
+    }
+}
+
+void release_pooled_buffers() {
+    free_all(&thread_cache);
+
+    pthread_mutex_lock(&shared_pool_lock);
+    free_all(&shared_pool);
+    pthread_mutex_unlock(&shared_pool_lock);
+}
+
+BufferStats buffer_stats() {
+    BufferStats stats;
+    stats.allocations = atomic_load_explicit(&allocation_count, memory_order_relaxed);
+    stats.pool_hits = atomic_load_explicit(&pool_hit_count, memory_order_relaxed);
+    stats.system_allocations = atomic_load_explicit(&system_allocation_count, memory_order_relaxed);
+    stats.frees = atomic_load_explicit(&free_count, memory_order_relaxed);
+    stats.bytes_in_use = atomic_load_explicit(&bytes_in_use, memory_order_relaxed);
+    stats.peak_bytes_in_use = atomic_load_explicit(&peak_bytes_in_use, memory_order_relaxed);
+    stats.bytes_pooled = atomic_load_explicit(&bytes_pooled, memory_order_relaxed);
+    return stats;
+}
+
+double pool_hit_rate(const BufferStats* stats) {
+    return (stats->allocations > 0) ? (double)stats->pool_hits / stats->allocations : 0.0;
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include <math.h>
+#include <string.h>
+#include "maths/fast_math.h"
+#include "maths/fast_math_priv.h"
+
+// Scalar forms of the approximations, which are also used for the elements left over at the end of each SIMD
+// kernel. The kernels in simd.c follow the same steps on whole vectors.
+
+static ScalarBits scalar_to_bits(Scalar x) {
+    ScalarBits bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return bits;
+}
+
+static Scalar bits_to_scalar(ScalarBits bits) {
+    Scalar x;
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+Scalar fast_exp(Scalar x) {
+    if (x > FAST_EXP_MAX) {
+        return INFINITY;
+    }
+    if (x < FAST_EXP_MIN) {
+        return 0;
+    }
+
+    // x = k * ln(2) + r, with k an integer and |r| <= ln(2)/2, so exp(x) = 2^k * exp(r). 2^k is built directly
+    // from its exponent bits.
+    Scalar shifted = x * (Scalar)FAST_MATH_LOG2E + FAST_MATH_ROUNDING_MAGIC;
+    Scalar k = shifted - FAST_MATH_ROUNDING_MAGIC;
+    Scalar r = (x - k * (Scalar)FAST_MATH_LN2_HI) - k * (Scalar)FAST_MATH_LN2_LO;
+
+    Scalar p = fast_exp_coefficients[FAST_EXP_DEGREE];
+    for (int i=FAST_EXP_DEGREE-1; i >= 0; i--) {
+        p = p * r + fast_exp_coefficients[i];
+    }
+
+    ScalarBits k_bits = scalar_to_bits(shifted) - FAST_MATH_ROUNDING_MAGIC_BITS;
+    ScalarBits scale = (k_bits + FAST_MATH_EXPONENT_BIAS) << FAST_MATH_MANTISSA_BITS;
+    return p * bits_to_scalar(scale);
+}
+
+Scalar fast_log(Scalar x) {
+    // x = 2^e * m with m in [sqrt(0.5), sqrt(2)), found by offsetting the bits of x so that the exponent
+    // rounds up from sqrt(0.5) rather than from 1. Then log(x) = e * ln(2) + log(m).
+    ScalarBits bits = scalar_to_bits(x);
+    ScalarBits e = (bits - FAST_MATH_SQRT_HALF_BITS) >> FAST_MATH_MANTISSA_BITS;
+    Scalar m = bits_to_scalar(bits - (e << FAST_MATH_MANTISSA_BITS));
+
+    Scalar s = (m - 1) / (m + 1);
+    Scalar s2 = s * s;
+    Scalar q = fast_log_coefficients[FAST_LOG_TERMS-1];
+    for (int i=FAST_LOG_TERMS-2; i >= 0; i--) {
+        q = q * s2 + fast_log_coefficients[i];
+    }
+
+    Scalar e_scalar = bits_to_scalar(e + FAST_MATH_ROUNDING_MAGIC_BITS) - FAST_MATH_ROUNDING_MAGIC;
+    return e_scalar * (Scalar)FAST_MATH_LN2_HI + (s * q + e_scalar * (Scalar)FAST_MATH_LN2_LO);
+}
+
+Scalar fast_sigmoid(Scalar x) {
+    return 1 / (1 + fast_exp(-x));
+}
+
+Scalar fast_tanh(Scalar x) {
+    // tanh(|x|) = (1 - e^{-2|x|}) / (1 + e^{-2|x|}), where the exponential cannot overflow, with the sign of x
+    // restored afterwards.
+    Scalar e = fast_exp(-2 * ((x < 0) ? -x : x));
+    Scalar t = (1 - e) / (1 + e);
+    return (x < 0) ? -t : t;
+}
\ No newline at end of file
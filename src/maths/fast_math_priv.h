@@ -0,0 +1,52 @@
+#ifndef FAST_MATH_PRIV_H
+#define FAST_MATH_PRIV_H
+
+#include <stdint.h>
+#include "maths/scalar.h"
+
+// Constants shared by the scalar approximations in fast_math.c and the SIMD kernels in simd.c, so that both
+// evaluate the same polynomials after the same range reductions. Integers are moved between the exponent of a
+// Scalar and ordinary arithmetic without conversion instructions, which most SIMD instruction sets lack for
+// 64-bit integers: after adding FAST_MATH_ROUNDING_MAGIC to a value, the low bits of the sum hold it rounded to
+// an integer, so for an integer k, bits(k + MAGIC) = MAGIC_BITS + k.
+
+#ifdef NN_FLOAT32
+typedef int32_t ScalarBits; // Integer with the same size as Scalar, for manipulating its exponent
+#define FAST_MATH_MANTISSA_BITS 23
+#define FAST_MATH_EXPONENT_BIAS 127
+#define FAST_MATH_ROUNDING_MAGIC 12582912.0f // 1.5 * 2^23: adding it rounds values below 2^22 to integers
+#define FAST_MATH_ROUNDING_MAGIC_BITS 0x4b400000
+#define FAST_MATH_SQRT_HALF_BITS 0x3f3504f3 // Bits of sqrt(0.5)
+#define FAST_EXP_MAX 88.0f // exp saturates to infinity above this, and flushes to 0 below FAST_EXP_MIN
+#define FAST_EXP_MIN -87.0f
+#define FAST_EXP_DEGREE 7
+#define FAST_LOG_TERMS 5
+#else
+typedef int64_t ScalarBits;
+#define FAST_MATH_MANTISSA_BITS 52
+#define FAST_MATH_EXPONENT_BIAS 1023
+#define FAST_MATH_ROUNDING_MAGIC 6755399441055744.0 // 1.5 * 2^52
+#define FAST_MATH_ROUNDING_MAGIC_BITS 0x4338000000000000LL
+#define FAST_MATH_SQRT_HALF_BITS 0x3fe6a09e667f3bcdLL
+#define FAST_EXP_MAX 709.0
+#define FAST_EXP_MIN -708.0
+#define FAST_EXP_DEGREE 12
+#define FAST_LOG_TERMS 10
+#endif
+
+#define FAST_MATH_LOG2E 1.4426950408889634
+// ln(2) split into a part with few significant bits, whose product with small integers is exact, and the rest
+#define FAST_MATH_LN2_HI 0.693145751953125
+#define FAST_MATH_LN2_LO 1.4286068203094173e-06
+
+// exp(r) for |r| <= ln(2)/2 is approximated by its Taylor series up to r^FAST_EXP_DEGREE, with coefficients
+// 1/k!, evaluated by Horner's method from the highest degree down.
+static const Scalar fast_exp_coefficients[] = {1.0, 1.0, 1.0/2, 1.0/6, 1.0/24, 1.0/120, 1.0/720, 1.0/5040,
+    1.0/40320, 1.0/362880, 1.0/3628800, 1.0/39916800, 1.0/479001600, 1.0/6227020800};
+
+// log(m) for m in [sqrt(0.5), sqrt(2)) is approximated as 2 * atanh(s), with s = (m - 1) / (m + 1), using the
+// first FAST_LOG_TERMS terms of its series 2 * (s + s^3/3 + s^5/5 + ...), written as s * q(s^2).
+static const Scalar fast_log_coefficients[] = {2.0, 2.0/3, 2.0/5, 2.0/7, 2.0/9, 2.0/11, 2.0/13, 2.0/15,
+    2.0/17, 2.0/19, 2.0/21};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,248 @@
+#include <stdlib.h>
+#include <string.h>
+#include "maths/gemm.h"
+#include "maths/aligned_buffer.h"
+
+// 16 bytes per vector is the widest width every x86-64 CPU supports (SSE2), which holds two doubles or four
+// floats.
+#define VEC_LEN (16 / (int)sizeof(Scalar))
+typedef Scalar vec __attribute__((vector_size(16)));
+
+// The micro-kernel computes an MR x NR tile of C, held entirely in registers, from an MR-row panel of A
+// and an NR-column panel of B. Each row of the tile is two vectors wide, so a float tile has twice as many
+// columns as a double one.
+#define MR 4
+#define NR (2 * VEC_LEN)
+
+// Cache blocking sizes: a KC x NR panel of B is reused from L1 across a whole MC x KC block of A (held in
+// L2), and the packed KC x NC block of B is sized for L3.
+#define MC 128
+#define KC 256
+#define NC 2048
+
+// Below this many multiply-adds, packing the operands costs more than it saves.
+#define SMALL_GEMM_THRESHOLD 4096
+
+// Packing buffers are kept per thread and grown on demand, so that repeated calls do not allocate.
+static _Thread_local Scalar* packed_a = NULL;
+static _Thread_local size_t packed_a_capacity = 0;
+static _Thread_local Scalar* packed_b = NULL;
+static _Thread_local size_t packed_b_capacity = 0;
+
+static Scalar* reserve_buffer(Scalar** buffer, size_t* capacity, size_t count) {
+    // Returns a 64-byte aligned buffer holding at least count elements, reallocating only if it is too small.
+    if (count > *capacity) {
+        free_aligned(*buffer);
+        size_t bytes = ((count * sizeof(Scalar) + 63) / 64) * 64;
+        *buffer = alloc_aligned(bytes);
+        *capacity = (*buffer == NULL) ? 0 : bytes / sizeof(Scalar);
+    }
+    return *buffer;
+}
+
+static inline const Scalar* op_address(GemmTranspose trans, const Scalar* matrix, int ld, int row, int col) {
+    // Returns the address of element (row, col) of op(matrix), where op either leaves the matrix as-is or
+    // transposes it.
+    return (trans == GEMM_TRANS) ? &matrix[col * ld + row] : &matrix[row * ld + col];
+}
+
+static inline Scalar op_element(GemmTranspose trans, const Scalar* matrix, int ld, int row, int col) {
+    return *op_address(trans, matrix, ld, row, col);
+}
+
+static void pack_a(GemmTranspose trans_a, int mc, int kc, const Scalar* a, int lda, Scalar* packed) {
+    // Copies an mc x kc block of op(A) into consecutive MR-row panels, each stored column by column. Rows
+    // past the edge of op(A) are zero-padded so the micro-kernel never needs to special-case them.
+    for (int i=0; i < mc; i += MR) {
+        int rows = (mc - i < MR) ? mc - i : MR;
+        for (int p=0; p < kc; p++) {
+            for (int r=0; r < MR; r++) {
+                packed[r] = (r < rows) ? op_element(trans_a, a, lda, i + r, p) : 0.0;
+            }
+            packed += MR;
+        }
+    }
+}
+
+static void pack_b(GemmTranspose trans_b, int kc, int nc, const Scalar* b, int ldb, Scalar* packed) {
+    // Copies a kc x nc block of op(B) into consecutive NR-column panels, each stored row by row, with columns
+    // past the edge of op(B) zero-padded.
+    for (int j=0; j < nc; j += NR) {
+        int cols = (nc - j < NR) ? nc - j : NR;
+        for (int p=0; p < kc; p++) {
+            for (int c=0; c < NR; c++) {
+                packed[c] = (c < cols) ? op_element(trans_b, b, ldb, p, j + c) : 0.0;
+            }
+            packed += NR;
+        }
+    }
+}
+
+static void apply_bias_to_row(const GemmEpilogue* epilogue, int row, int first_col, Scalar* c_row, int n) {
+    // Adds the bias to n finished elements of row `row` of C, starting from column first_col.
+    if (epilogue->row_bias != NULL) {
+        Scalar bias = epilogue->row_bias[row * epilogue->bias_stride];
+        for (int j=0; j < n; j++) {
+            c_row[j] += bias;
+        }
+    }
+    if (epilogue->col_bias != NULL) {
+        const Scalar* bias = &epilogue->col_bias[first_col * epilogue->bias_stride];
+        for (int j=0; j < n; j++) {
+            c_row[j] += bias[j * epilogue->bias_stride];
+        }
+    }
+}
+
+static void apply_activation_to_rows(const GemmEpilogue* epilogue, const Scalar* c, int ldc, int first_row,
+    int rows, int first_col, int n) {
+    // Applies the activation to a finished block of C, of the given rows and n columns starting from
+    // first_col, one whole row of the block at a time, or all at once if the block's rows are contiguous.
+    if (epilogue->activation == NULL) {
+        return;
+    }
+    if (first_col == 0 && n == ldc && n == epilogue->ldout) {
+        epilogue->activation(&c[first_row * ldc], &epilogue->out[first_row * epilogue->ldout], rows * n);
+        return;
+    }
+    for (int i=first_row; i < first_row + rows; i++) {
+        epilogue->activation(&c[i * ldc + first_col], &epilogue->out[i * epilogue->ldout + first_col], n);
+    }
+}
+
+static void micro_kernel(int kc, const Scalar* a_panel, const Scalar* b_panel, Scalar* c, int ldc,
+    int accumulate, int mr, int nr, const GemmEpilogue* epilogue, int tile_row, int tile_col) {
+    // Multiplies an MR x kc panel of A by a kc x NR panel of B, with all MR x NR partial sums kept in vector
+    // registers. The tile is then written to (or added to) the top-left mr x nr corner of C, which starts at
+    // row tile_row and column tile_col of the whole of C. If this was the final block along k, epilogue is not
+    // NULL and its bias is added to the finished tile.
+    vec acc[MR][NR / VEC_LEN];
+    memset(acc, 0, sizeof(acc));
+
+    for (int p=0; p < kc; p++) {
+        const vec* b_row = (const vec*)&b_panel[p * NR];
+        const Scalar* a_col = &a_panel[p * MR];
+
+        for (int i=0; i < MR; i++) {
+            for (int v=0; v < NR / VEC_LEN; v++) {
+                acc[i][v] += a_col[i] * b_row[v];
+            }
+        }
+    }
+
+    Scalar tile[MR][NR];
+    memcpy(tile, acc, sizeof(tile));
+
+    for (int i=0; i < mr; i++) {
+        Scalar* c_row = &c[i * ldc];
+        if (accumulate) {
+            for (int j=0; j < nr; j++) {
+                c_row[j] += tile[i][j];
+            }
+        }
+        else {
+            for (int j=0; j < nr; j++) {
+                c_row[j] = tile[i][j];
+            }
+        }
+
+        if (epilogue != NULL) {
+            apply_bias_to_row(epilogue, tile_row + i, tile_col, c_row, nr);
+        }
+    }
+}
+
+static void small_gemm(GemmTranspose trans_a, GemmTranspose trans_b, int m, int n, int k, const Scalar* a,
+    int lda, const Scalar* b, int ldb, Scalar* c, int ldc, const GemmEpilogue* epilogue) {
+    // Unblocked i-p-j loop for tiny products, which walks C (and B, when it is not transposed) along its rows.
+    for (int i=0; i < m; i++) {
+        Scalar* c_row = &c[i * ldc];
+        for (int j=0; j < n; j++) {
+            c_row[j] = 0.0;
+        }
+
+        for (int p=0; p < k; p++) {
+            Scalar a_ip = op_element(trans_a, a, lda, i, p);
+            for (int j=0; j < n; j++) {
+                c_row[j] += a_ip * op_element(trans_b, b, ldb, p, j);
+            }
+        }
+
+        if (epilogue != NULL) {
+            apply_bias_to_row(epilogue, i, 0, c_row, n);
+        }
+    }
+
+    if (epilogue != NULL) {
+        apply_activation_to_rows(epilogue, c, ldc, 0, m, 0, n);
+    }
+}
+
+void gemm(GemmTranspose trans_a, GemmTranspose trans_b, int m, int n, int k, const Scalar* a, int lda,
+    const Scalar* b, int ldb, Scalar* c, int ldc) {
+    gemm_epilogue(trans_a, trans_b, m, n, k, a, lda, b, ldb, c, ldc, NULL);
+}
+
+void gemm_epilogue(GemmTranspose trans_a, GemmTranspose trans_b, int m, int n, int k, const Scalar* a, int lda,
+    const Scalar* b, int ldb, Scalar* c, int ldc, const GemmEpilogue* epilogue) {
+    if (m <= 0 || n <= 0) {
+        return;
+    }
+
+    if ((long)m * n * k < SMALL_GEMM_THRESHOLD) {
+        small_gemm(trans_a, trans_b, m, n, k, a, lda, b, ldb, c, ldc, epilogue);
+        return;
+    }
+
+    int max_kc = (k < KC) ? k : KC;
+    int max_mc = (m < MC) ? m : MC;
+    int max_nc = (n < NC) ? n : NC;
+    Scalar* a_buffer = reserve_buffer(&packed_a, &packed_a_capacity,
+        (size_t)((max_mc + MR - 1) / MR) * MR * max_kc);
+    Scalar* b_buffer = reserve_buffer(&packed_b, &packed_b_capacity,
+        (size_t)((max_nc + NR - 1) / NR) * NR * max_kc);
+
+    if (a_buffer == NULL || b_buffer == NULL) {
+        small_gemm(trans_a, trans_b, m, n, k, a, lda, b, ldb, c, ldc, epilogue);
+        return;
+    }
+
+    for (int jc=0; jc < n; jc += NC) {
+        int nc = (n - jc < NC) ? n - jc : NC;
+
+        for (int pc=0; pc < k; pc += KC) {
+            int kc = (k - pc < KC) ? k - pc : KC;
+            // The first block along k overwrites C, later blocks accumulate onto it, and the epilogue is
+            // applied by the last.
+            int accumulate = (pc > 0);
+            const GemmEpilogue* tile_epilogue = (pc + kc == k) ? epilogue : NULL;
+
+            pack_b(trans_b, kc, nc, op_address(trans_b, b, ldb, pc, jc), ldb, b_buffer);
+
+            for (int ic=0; ic < m; ic += MC) {
+                int mc = (m - ic < MC) ? m - ic : MC;
+
+                pack_a(trans_a, mc, kc, op_address(trans_a, a, lda, ic, pc), lda, a_buffer);
+
+                for (int jr=0; jr < nc; jr += NR) {
+                    int nr = (nc - jr < NR) ? nc - jr : NR;
+                    const Scalar* b_panel = &b_buffer[jr * kc];
+
+                    for (int ir=0; ir < mc; ir += MR) {
+                        int mr = (mc - ir < MR) ? mc - ir : MR;
+                        const Scalar* a_panel = &a_buffer[ir * kc];
+
+                        micro_kernel(kc, a_panel, b_panel, &c[(ic + ir) * ldc + jc + jr], ldc, accumulate,
+                            mr, nr, tile_epilogue, ic + ir, jc + jr);
+                    }
+                }
+
+                // The activation is applied once the block is finished, while it is still in cache, so that
+                // each call covers a whole row of the block rather than the few columns of one tile.
+                if (tile_epilogue != NULL) {
+                    apply_activation_to_rows(tile_epilogue, c, ldc, ic, mc, jc, nc);
+                }
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -3,13 +3,45 @@
 #include "maths/loss.h"
 #include "maths/matrix.h"
 
-const LossFunc MSE = {&mean_squared_error, &mean_squared_error_derivative};
-const LossFunc MAE = {&mean_absolute_error, &mean_absolute_error_derivative};
-const LossFunc BCE = {&binary_cross_entropy, &binary_cross_entropy_derivative};
-const LossFunc CCE = {&categorical_cross_entropy, &categorical_cross_entropy_derivative};
+const LossFunc MSE = {&mean_squared_error, &mean_squared_error_derivative,
+    &mean_squared_error_derivative_into, &mean_squared_error_with_derivative_into};
+const LossFunc MAE = {&mean_absolute_error, &mean_absolute_error_derivative,
+    &mean_absolute_error_derivative_into, &mean_absolute_error_with_derivative_into};
+const LossFunc BCE = {&binary_cross_entropy, &binary_cross_entropy_derivative,
+    &binary_cross_entropy_derivative_into, &binary_cross_entropy_with_derivative_into};
+const LossFunc CCE = {&categorical_cross_entropy, &categorical_cross_entropy_derivative,
+    &categorical_cross_entropy_derivative_into, &categorical_cross_entropy_with_derivative_into};
 
 static const double epsilon = 1e-15;
 
+static double log_with_accuracy(double x, MathAccuracy accuracy) {
+    return (accuracy == MATH_FAST) ? fast_log((Scalar)x) : log(x);
+}
+
+static int storage_views(Matrix* gradient_view, Matrix* y_view, Matrix* y_pred_view, const Matrix* gradient_matrix,
+    const Matrix* y, const Matrix* y_pred) {
+    // The fused functions below walk their matrices a row at a time, in the order they are stored, through their
+    // storage views. That is only possible if every matrix has the same layout, in which case the views are
+    // filled in and 1 is returned; otherwise returns 0.
+    if (y->layout != gradient_matrix->layout || y_pred->layout != gradient_matrix->layout) {
+        return 0;
+    }
+    *gradient_view = matrix_storage_view(gradient_matrix);
+    *y_view = matrix_storage_view(y);
+    *y_pred_view = matrix_storage_view(y_pred);
+    return 1;
+}
+
+static void scaled_difference_into(Matrix* gradient_matrix, const Matrix* y, const Matrix* y_pred, double scale) {
+    // Writes (y_pred - y) * scale into gradient_matrix, an element at a time.
+    for (int row_count=0; row_count < y->rows; row_count++) {
+        for (int col_count=0; col_count < y->cols; col_count++) {
+            Scalar diff = get_element(y_pred, row_count, col_count) - get_element(y, row_count, col_count);
+            set_element(gradient_matrix, row_count, col_count, diff * scale);
+        }
+    }
+}
+
 double mean_squared_error(const Matrix* y, const Matrix* y_pred) {
     double squared_diff_sum = 0.0;
     for (int col_count=0; col_count < y->cols; col_count++) { // Each column represents a sample
@@ -24,19 +56,51 @@ double mean_squared_error(const Matrix* y, const Matrix* y_pred) {
 
 Matrix mean_squared_error_derivative(const Matrix* y, const Matrix* y_pred) {
     // Creates matrix of MSE's partial derivatives with respect to each of the predictions.
-    Matrix gradient_matrix = create_matrix(y->rows, y->cols);
-    
+    Matrix gradient_matrix = create_uninitialised_matrix(y->rows, y->cols, y->layout);
+    mean_squared_error_derivative_into(&gradient_matrix, y, y_pred);
+
+    return gradient_matrix;
+}
+
+void mean_squared_error_derivative_into(Matrix* gradient_matrix, const Matrix* y, const Matrix* y_pred) {
+    // Writes MSE's partial derivatives with respect to each of the predictions into gradient_matrix, which must
+    // have the same dimensions as y.
     for (int col_count=0; col_count < y->cols; col_count++) { // Each column represents a sample
         for (int row_count=0; row_count < y->rows; row_count++) {
             double y_i = get_element(y, row_count, col_count);
             double y_pred_i = get_element(y_pred, row_count, col_count);
 
             double grad = (2.0/(y->rows * y->cols)) * (y_pred_i - y_i);
-            set_element(&gradient_matrix, row_count, col_count, grad);
+            set_element(gradient_matrix, row_count, col_count, grad);
         }
     }
+}
 
-    return gradient_matrix;
+double mean_squared_error_with_derivative_into(Matrix* gradient_matrix, const Matrix* y, const Matrix* y_pred) {
+    // Writes MSE's partial derivatives into gradient_matrix and returns the loss, reading each element of y and
+    // y_pred once for both.
+    Matrix gradient_view, y_view, y_pred_view;
+    if (!storage_views(&gradient_view, &y_view, &y_pred_view, gradient_matrix, y, y_pred)) {
+        // Matrices of different layouts are handled by the separate, element-at-a-time functions.
+        mean_squared_error_derivative_into(gradient_matrix, y, y_pred);
+        return mean_squared_error(y, y_pred);
+    }
+
+    double scale = 2.0/(y->rows * y->cols);
+    double squared_diff_sum = 0.0;
+    for (int row_count=0; row_count < y_view.rows; row_count++) {
+        const Scalar* y_row = &y_view.data[(size_t)row_count * y_view.stride];
+        const Scalar* y_pred_row = &y_pred_view.data[(size_t)row_count * y_pred_view.stride];
+        Scalar* grad_row = &gradient_view.data[(size_t)row_count * gradient_view.stride];
+
+        for (int col_count=0; col_count < y_view.cols; col_count++) {
+            double diff = y_row[col_count] - y_pred_row[col_count];
+            squared_diff_sum += (diff * diff);
+            grad_row[col_count] = scale * -diff;
+        }
+    }
+
+    return (squared_diff_sum / (y->rows * y->cols));
 }
 
 double mean_absolute_error(const Matrix* y, const Matrix* y_pred) {
@@ -53,8 +117,15 @@ double mean_absolute_error(const Matrix* y, const Matrix* y_pred) {
 
 Matrix mean_absolute_error_derivative(const Matrix* y, const Matrix* y_pred) {
     // Creates matrix of MAE's partial derivatives with respect to each of the predictions.
-    Matrix gradient_matrix = create_matrix(y->rows, y->cols);
+    Matrix gradient_matrix = create_uninitialised_matrix(y->rows, y->cols, y->layout);
+    mean_absolute_error_derivative_into(&gradient_matrix, y, y_pred);
+
+    return gradient_matrix;
+}
 
+void mean_absolute_error_derivative_into(Matrix* gradient_matrix, const Matrix* y, const Matrix* y_pred) {
+    // Writes MAE's partial derivatives with respect to each of the predictions into gradient_matrix, which must
+    // have the same dimensions as y.
     for (int col_count=0; col_count < y->cols; col_count++) { // Each column represents a sample
         for (int row_count=0; row_count < y->rows; row_count++) {
             double y_i = get_element(y, row_count, col_count);
@@ -62,17 +133,44 @@ Matrix mean_absolute_error_derivative(const Matrix* y, const Matrix* y_pred) {
 
             if (y_i == y_pred_i) {
                 // MAE's derivative is actually undefined at y_i = y_pred_i, but here it is considered to be 0.
-                // Setting to zero is unneeded as matrix initialised to all zeros, but want to make it explicit.
-                set_element(&gradient_matrix, row_count, col_count, 0); 
+                // Set explicitly, as the gradient matrix may be reused and so hold values from a previous call.
+                set_element(gradient_matrix, row_count, col_count, 0); 
             }
             else {
                 double grad = (y_i > y_pred_i) ? -1.0 / (y->rows * y->cols) : 1.0 / (y->rows * y->cols);
-                set_element(&gradient_matrix, row_count, col_count, grad);
+                set_element(gradient_matrix, row_count, col_count, grad);
             }
         }
     }
+}
 
-    return gradient_matrix;
+double mean_absolute_error_with_derivative_into(Matrix* gradient_matrix, const Matrix* y, const Matrix* y_pred) {
+    // Writes MAE's partial derivatives into gradient_matrix and returns the loss, reading each element of y and
+    // y_pred once for both.
+    Matrix gradient_view, y_view, y_pred_view;
+    if (!storage_views(&gradient_view, &y_view, &y_pred_view, gradient_matrix, y, y_pred)) {
+        // Matrices of different layouts are handled by the separate, element-at-a-time functions.
+        mean_absolute_error_derivative_into(gradient_matrix, y, y_pred);
+        return mean_absolute_error(y, y_pred);
+    }
+
+    double grad_size = 1.0 / (y->rows * y->cols);
+    double abs_diff_sum = 0.0;
+    for (int row_count=0; row_count < y_view.rows; row_count++) {
+        const Scalar* y_row = &y_view.data[(size_t)row_count * y_view.stride];
+        const Scalar* y_pred_row = &y_pred_view.data[(size_t)row_count * y_pred_view.stride];
+        Scalar* grad_row = &gradient_view.data[(size_t)row_count * gradient_view.stride];
+
+        for (int col_count=0; col_count < y_view.cols; col_count++) {
+            double diff = y_row[col_count] - y_pred_row[col_count];
+            abs_diff_sum += fabs(diff);
+
+            // As for mean_absolute_error_derivative_into, the derivative is taken as 0 where it is undefined.
+            grad_row[col_count] = (diff > 0) ? -grad_size : (diff < 0) ? grad_size : 0.0;
+        }
+    }
+
+    return (abs_diff_sum / (y->rows * y->cols));
 }
 
 double binary_cross_entropy(const Matrix* y, const Matrix* y_pred) {
@@ -101,8 +199,15 @@ double binary_cross_entropy(const Matrix* y, const Matrix* y_pred) {
 
 Matrix binary_cross_entropy_derivative(const Matrix* y, const Matrix* y_pred) {
     // Creates matrix of BCE's partial derivatives with respect to each of the predictions.
-    Matrix gradient_matrix = create_matrix(y->rows, y->cols);
+    Matrix gradient_matrix = create_uninitialised_matrix(y->rows, y->cols, y->layout);
+    binary_cross_entropy_derivative_into(&gradient_matrix, y, y_pred);
+
+    return gradient_matrix;
+}
 
+void binary_cross_entropy_derivative_into(Matrix* gradient_matrix, const Matrix* y, const Matrix* y_pred) {
+    // Writes BCE's partial derivatives with respect to each of the predictions into gradient_matrix, which must
+    // have the same dimensions as y.
     for (int col_count=0; col_count < y->cols; col_count++) {
         for (int row_count=0; row_count < y->rows; row_count++) {
             double y_i = get_element(y, row_count, col_count);
@@ -116,11 +221,44 @@ Matrix binary_cross_entropy_derivative(const Matrix* y, const Matrix* y_pred) {
             }
 
             double grad = (-1.0/(y->rows * y->cols)) * ((y_i/y_pred_i) - ((1-y_i) / (1-y_pred_i)));
-            set_element(&gradient_matrix, row_count, col_count, grad);
+            set_element(gradient_matrix, row_count, col_count, grad);
         }
     }
+}
 
-    return gradient_matrix;
+double binary_cross_entropy_with_derivative_into(Matrix* gradient_matrix, const Matrix* y, const Matrix* y_pred) {
+    // Writes BCE's partial derivatives into gradient_matrix and returns the loss, reading and clipping each
+    // element of y and y_pred once for both.
+    Matrix gradient_view, y_view, y_pred_view;
+    if (!storage_views(&gradient_view, &y_view, &y_pred_view, gradient_matrix, y, y_pred)) {
+        // Matrices of different layouts are handled by the separate, element-at-a-time functions.
+        binary_cross_entropy_derivative_into(gradient_matrix, y, y_pred);
+        return binary_cross_entropy(y, y_pred);
+    }
+
+    double sum = 0.0;
+    for (int row_count=0; row_count < y_view.rows; row_count++) {
+        const Scalar* y_row = &y_view.data[(size_t)row_count * y_view.stride];
+        const Scalar* y_pred_row = &y_pred_view.data[(size_t)row_count * y_pred_view.stride];
+        Scalar* grad_row = &gradient_view.data[(size_t)row_count * gradient_view.stride];
+
+        for (int col_count=0; col_count < y_view.cols; col_count++) {
+            double y_i = y_row[col_count];
+            double y_pred_i = y_pred_row[col_count];
+
+            if (y_pred_i < epsilon) {
+                y_pred_i = epsilon;
+            }
+            else if (y_pred_i > 1.0 - epsilon) {
+                y_pred_i = 1.0 - epsilon;
+            }
+
+            sum += -(y_i * log(y_pred_i) + (1.0-y_i)*log(1.0-y_pred_i));
+            grad_row[col_count] = (-1.0/(y->rows * y->cols)) * ((y_i/y_pred_i) - ((1-y_i) / (1-y_pred_i)));
+        }
+    }
+
+    return (sum / (y->rows * y->cols));
 }
 
 double categorical_cross_entropy(const Matrix* y, const Matrix* y_pred) {
@@ -147,8 +285,15 @@ double categorical_cross_entropy(const Matrix* y, const Matrix* y_pred) {
 
 Matrix categorical_cross_entropy_derivative(const Matrix* y, const Matrix* y_pred) {
     // Creates matrix of CCE's partial derivatives with respect to each of the predictions.
-    Matrix gradient_matrix = create_matrix(y->rows, y->cols);
+    Matrix gradient_matrix = create_uninitialised_matrix(y->rows, y->cols, y->layout);
+    categorical_cross_entropy_derivative_into(&gradient_matrix, y, y_pred);
+
+    return gradient_matrix;
+}
 
+void categorical_cross_entropy_derivative_into(Matrix* gradient_matrix, const Matrix* y, const Matrix* y_pred) {
+    // Writes CCE's partial derivatives with respect to each of the predictions into gradient_matrix, which must
+    // have the same dimensions as y.
     for (int col_count=0; col_count < y->cols; col_count++) {
         for (int row_count=0; row_count < y->rows; row_count++) {
             double y_i = get_element(y, row_count, col_count);
@@ -159,9 +304,117 @@ Matrix categorical_cross_entropy_derivative(const Matrix* y, const Matrix* y_pre
             }
 
             double grad = -(y_i / y_pred_i) / y->cols;
-            set_element(&gradient_matrix, row_count, col_count, grad);
+            set_element(gradient_matrix, row_count, col_count, grad);
         }
     }
+}
 
-    return gradient_matrix;
+double categorical_cross_entropy_with_derivative_into(Matrix* gradient_matrix, const Matrix* y,
+    const Matrix* y_pred) {
+    // Writes CCE's partial derivatives into gradient_matrix and returns the loss, reading each element of y and
+    // y_pred once for both. As in the separate functions, predictions are clipped to [epsilon, 1-epsilon] for
+    // the loss, but only from below for the derivative.
+    Matrix gradient_view, y_view, y_pred_view;
+    if (!storage_views(&gradient_view, &y_view, &y_pred_view, gradient_matrix, y, y_pred)) {
+        // Matrices of different layouts are handled by the separate, element-at-a-time functions.
+        categorical_cross_entropy_derivative_into(gradient_matrix, y, y_pred);
+        return categorical_cross_entropy(y, y_pred);
+    }
+
+    double sum = 0.0;
+    for (int row_count=0; row_count < y_view.rows; row_count++) {
+        const Scalar* y_row = &y_view.data[(size_t)row_count * y_view.stride];
+        const Scalar* y_pred_row = &y_pred_view.data[(size_t)row_count * y_pred_view.stride];
+        Scalar* grad_row = &gradient_view.data[(size_t)row_count * gradient_view.stride];
+
+        for (int col_count=0; col_count < y_view.cols; col_count++) {
+            double y_i = y_row[col_count];
+            double y_pred_i = y_pred_row[col_count];
+            if (y_pred_i < epsilon) {
+                y_pred_i = epsilon;
+            }
+
+            double clipped = (y_pred_i > 1.0 - epsilon) ? 1.0 - epsilon : y_pred_i;
+            sum += -y_i * log(clipped);
+            grad_row[col_count] = -(y_i / y_pred_i) / y->cols;
+        }
+    }
+
+    return (sum / y->cols);
+}
+
+double softmax_cross_entropy_gradient_into(Matrix* gradient_matrix, const Matrix* y, const Matrix* y_pred,
+    MathAccuracy accuracy) {
+    // CCE's derivative is -y_i / (y_pred_i * cols), and multiplying it by the softmax Jacobian, whose (i, j)
+    // entry is y_pred_i * (δ_ij - y_pred_j), gives (y_pred_j * Σ y_i - y_j) / cols = (y_pred_j - y_j) / cols.
+    // The loss is accumulated in the same pass, only taking a logarithm where y_j is non-zero.
+    Matrix gradient_view, y_view, y_pred_view;
+    if (!storage_views(&gradient_view, &y_view, &y_pred_view, gradient_matrix, y, y_pred)) {
+        // Matrices of different layouts are handled an element at a time, with the loss calculated exactly.
+        scaled_difference_into(gradient_matrix, y, y_pred, 1.0 / y->cols);
+        return categorical_cross_entropy(y, y_pred);
+    }
+
+    double scale = 1.0 / y->cols;
+    double sum = 0.0;
+    for (int row_count=0; row_count < y_view.rows; row_count++) {
+        const Scalar* y_row = &y_view.data[(size_t)row_count * y_view.stride];
+        const Scalar* y_pred_row = &y_pred_view.data[(size_t)row_count * y_pred_view.stride];
+        Scalar* grad_row = &gradient_view.data[(size_t)row_count * gradient_view.stride];
+
+        for (int col_count=0; col_count < y_view.cols; col_count++) {
+            double y_i = y_row[col_count];
+            double y_pred_i = y_pred_row[col_count];
+            if (y_i != 0.0) {
+                double clipped = (y_pred_i < epsilon) ? epsilon : (y_pred_i > 1.0 - epsilon) ? 1.0 - epsilon :
+                    y_pred_i;
+                sum += -y_i * log_with_accuracy(clipped, accuracy);
+            }
+
+            Scalar diff = y_pred_row[col_count] - y_row[col_count];
+            grad_row[col_count] = diff * scale;
+        }
+    }
+
+    return (sum / y->cols);
+}
+
+double sigmoid_binary_cross_entropy_gradient_into(Matrix* gradient_matrix, const Matrix* y, const Matrix* y_pred,
+    MathAccuracy accuracy) {
+    // BCE's derivative is (y_pred_i - y_i) / (y_pred_i * (1 - y_pred_i) * rows * cols), and sigmoid's is
+    // y_pred_i * (1 - y_pred_i), so their product is (y_pred_i - y_i) / (rows * cols). The loss is accumulated
+    // in the same pass, skipping whichever of its two terms has zero weight.
+    Matrix gradient_view, y_view, y_pred_view;
+    if (!storage_views(&gradient_view, &y_view, &y_pred_view, gradient_matrix, y, y_pred)) {
+        // Matrices of different layouts are handled an element at a time, with the loss calculated exactly.
+        scaled_difference_into(gradient_matrix, y, y_pred, 1.0 / (y->rows * y->cols));
+        return binary_cross_entropy(y, y_pred);
+    }
+
+    double scale = 1.0 / (y->rows * y->cols);
+    double sum = 0.0;
+    for (int row_count=0; row_count < y_view.rows; row_count++) {
+        const Scalar* y_row = &y_view.data[(size_t)row_count * y_view.stride];
+        const Scalar* y_pred_row = &y_pred_view.data[(size_t)row_count * y_pred_view.stride];
+        Scalar* grad_row = &gradient_view.data[(size_t)row_count * gradient_view.stride];
+
+        for (int col_count=0; col_count < y_view.cols; col_count++) {
+            double y_i = y_row[col_count];
+            double y_pred_i = y_pred_row[col_count];
+            double clipped = (y_pred_i < epsilon) ? epsilon : (y_pred_i > 1.0 - epsilon) ? 1.0 - epsilon : y_pred_i;
+            double term = 0.0;
+            if (y_i != 0.0) {
+                term += y_i * log_with_accuracy(clipped, accuracy);
+            }
+            if (y_i != 1.0) {
+                term += (1.0-y_i) * log_with_accuracy(1.0-clipped, accuracy);
+            }
+            sum += -term;
+
+            Scalar diff = y_pred_row[col_count] - y_row[col_count];
+            grad_row[col_count] = diff * scale;
+        }
+    }
+
+    return (sum * scale);
 }
\ No newline at end of file
@@ -1,19 +1,44 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
 #include "maths/matrix.h"
+#include "maths/aligned_buffer.h"
+#include "maths/gemm.h"
+#include "maths/simd.h"
+
+static int padded_stride(int rows, int cols, MatrixLayout layout) {
+    // Pads the rows of row-major matrices, such as parameters and workspaces, to a whole number of cache lines,
+    // so that each starts on a cache line boundary. Rows of a single element, as in a column vector, are left
+    // unpadded, as padding would give each element a cache line of its own. Column-major matrices hold datasets,
+    // whose columns are samples of only a few elements each, so are left dense rather than growing by up to a
+    // cache line per sample.
+    if (layout == MATRIX_COL_MAJOR) {
+        return rows;
+    }
+    int per_line = BUFFER_ALIGNMENT / (int)sizeof(Scalar);
+    return (cols <= 1) ? cols : (cols + per_line - 1) / per_line * per_line;
+}
 
 Matrix create_matrix(int rows, int cols) {
-    // Creates a matrix with the given dimensions, with all elements initialised to 0.
+    return create_matrix_with_layout(rows, cols, MATRIX_ROW_MAJOR);
+}
+
+static Matrix allocate_matrix(int rows, int cols, MatrixLayout layout, int zeroed) {
     Matrix new_matrix;
     new_matrix.rows = rows;
     new_matrix.cols = cols;
+    new_matrix.stride = padded_stride(rows, cols, layout);
+    new_matrix.storage = MATRIX_OWNED;
+    new_matrix.layout = layout;
 
     // If either dimension is less than or equal to zero, return an empty matrix.
     if (rows <= 0 || cols <= 0) {
         return empty_matrix();
     }
     else {
-        new_matrix.data = calloc(rows * cols, sizeof(double));
+        size_t bytes = matrix_storage_bytes(&new_matrix);
+        new_matrix.data = zeroed ? alloc_aligned_zeroed(bytes) : alloc_aligned(bytes);
 
         // Checking if memory allocation failed.
         if (new_matrix.data == NULL) {
@@ -25,43 +50,198 @@ Matrix create_matrix(int rows, int cols) {
     return new_matrix;
 }
 
+Matrix create_matrix_with_layout(int rows, int cols, MatrixLayout layout) {
+    // Creates a matrix with the given dimensions and layout, with all elements initialised to 0.
+    return allocate_matrix(rows, cols, layout, 1);
+}
+
+Matrix create_uninitialised_matrix(int rows, int cols, MatrixLayout layout) {
+    // Creates a matrix with the given dimensions and layout, leaving its elements as whatever its memory held.
+    return allocate_matrix(rows, cols, layout, 0);
+}
+
 Matrix empty_matrix() {
     // Returns an empty matrix, with dimensions of 0 by 0 and with data pointer set to NULL.
-    Matrix empty = {0, 0, NULL};
+    Matrix empty = {0, 0, NULL, 0, MATRIX_OWNED, MATRIX_ROW_MAJOR};
     return empty;
 }
 
+static inline size_t element_index(const Matrix* matrix, int row, int col) {
+    return (matrix->layout == MATRIX_COL_MAJOR) ? (size_t)col * matrix->stride + row :
+        (size_t)row * matrix->stride + col;
+}
+
+static inline Scalar* row_address(const Matrix* matrix, int row) {
+    // Only meaningful for row-major matrices, such as storage views.
+    return &matrix->data[row * matrix->stride];
+}
+
+static int is_contiguous(const Matrix* matrix) {
+    // Whether each row (or column, for column-major matrices) of a matrix directly follows the previous one, so
+    // its elements form a single array.
+    if (matrix->layout == MATRIX_COL_MAJOR) {
+        return matrix->stride == matrix->rows || matrix->cols <= 1;
+    }
+    return matrix->stride == matrix->cols || matrix->rows <= 1;
+}
+
+static int same_layout(const Matrix* matrix_a, const Matrix* matrix_b) {
+    return matrix_a->layout == matrix_b->layout;
+}
+
+static void apply_binary_kernel(void (*kernel)(const Scalar*, const Scalar*, Scalar*, int), Matrix* result,
+    const Matrix* matrix_a, const Matrix* matrix_b) {
+    // Runs an element-wise kernel over whole matrices if they are all contiguous, and otherwise row by row (or
+    // column by column, for column-major matrices). Matrices of different layouts are combined an element at a
+    // time.
+    if (!same_layout(result, matrix_a) || !same_layout(result, matrix_b)) {
+        for (int row_count=0; row_count < result->rows; row_count++) {
+            for (int col_count=0; col_count < result->cols; col_count++) {
+                kernel(&matrix_a->data[element_index(matrix_a, row_count, col_count)],
+                    &matrix_b->data[element_index(matrix_b, row_count, col_count)],
+                    &result->data[element_index(result, row_count, col_count)], 1);
+            }
+        }
+        return;
+    }
+
+    Matrix result_view = matrix_storage_view(result);
+    Matrix a_view = matrix_storage_view(matrix_a);
+    Matrix b_view = matrix_storage_view(matrix_b);
+    result = &result_view;
+    matrix_a = &a_view;
+    matrix_b = &b_view;
+
+    if (is_contiguous(result) && is_contiguous(matrix_a) && is_contiguous(matrix_b)) {
+        kernel(matrix_a->data, matrix_b->data, result->data, result->rows * result->cols);
+        return;
+    }
+
+    for (int row_count=0; row_count < result->rows; row_count++) {
+        kernel(row_address(matrix_a, row_count), row_address(matrix_b, row_count), row_address(result, row_count),
+            result->cols);
+    }
+}
+
+Matrix matrix_view(Scalar* data, int rows, int cols) {
+    return matrix_view_with_layout(data, rows, cols, MATRIX_ROW_MAJOR);
+}
+
+Matrix matrix_view_with_layout(Scalar* data, int rows, int cols, MatrixLayout layout) {
+    // Returns a matrix with the given dimensions and layout that uses existing data, which it does not own.
+    Matrix view = {rows, cols, data, (layout == MATRIX_COL_MAJOR) ? rows : cols, MATRIX_VIEW, layout};
+    return view;
+}
+
+Matrix matrix_column_view(const Matrix* matrix, int first_col, int num_cols) {
+    // Returns a view of num_cols consecutive columns of a matrix, starting from first_col, without copying.
+    Matrix view = {matrix->rows, num_cols, &matrix->data[element_index(matrix, 0, first_col)], matrix->stride,
+        MATRIX_VIEW, matrix->layout};
+    return view;
+}
+
+Matrix matrix_storage_view(const Matrix* matrix) {
+    // A column-major matrix's data, read as row-major, is its transpose.
+    if (matrix->layout == MATRIX_ROW_MAJOR) {
+        return *matrix;
+    }
+    Matrix view = {matrix->cols, matrix->rows, matrix->data, matrix->stride, MATRIX_VIEW, MATRIX_ROW_MAJOR};
+    return view;
+}
+
+Matrix matrix_mapped(Scalar* data, int rows, int cols, MatrixLayout layout) {
+    // Returns a matrix that owns a memory mapping of its data.
+    Matrix mapped = matrix_view_with_layout(data, rows, cols, layout);
+    mapped.storage = MATRIX_MAPPED;
+    return mapped;
+}
+
+size_t matrix_storage_bytes(const Matrix* matrix) {
+    size_t num_lines = (matrix->layout == MATRIX_COL_MAJOR) ? matrix->cols : matrix->rows;
+    return num_lines * matrix->stride * sizeof(Scalar);
+}
+
 void free_matrix(Matrix* matrix) {
-    // Frees memory allocated for a matrix.
+    // Releases the matrix's data according to where it lives, then resets it to an empty matrix.
     if (matrix->data != NULL) {
-        free(matrix->data);
-        matrix->data = NULL;
+        if (matrix->storage == MATRIX_OWNED) {
+            free_aligned(matrix->data);
+        }
+        else if (matrix->storage == MATRIX_MAPPED) {
+            munmap(matrix->data, matrix_storage_bytes(matrix));
+        }
     }
-    matrix->rows = 0;
-    matrix->cols = 0;
+    *matrix = empty_matrix();
+}
+
+void resize_matrix(Matrix* matrix, int rows, int cols) {
+    // Gives a matrix the specified dimensions. Its data is only reallocated if the space it needs, including
+    // padding, changes, so repeatedly resizing a matrix to the same dimensions never allocates.
+    MatrixLayout layout = matrix->layout;
+    Matrix resized = {rows, cols, matrix->data, padded_stride(rows, cols, layout), matrix->storage, layout};
+    if (matrix->data != NULL && matrix_storage_bytes(&resized) == matrix_storage_bytes(matrix)) {
+        *matrix = resized;
+        return;
+    }
+
+    free_matrix(matrix);
+    *matrix = create_uninitialised_matrix(rows, cols, layout);
 }
 
 Matrix copy_matrix(const Matrix* original) {
     // Creates a deep copy of a matrix.
-    Matrix copy = create_matrix(original->rows, original->cols);
-    for (int row_count=0; row_count < original->rows; row_count++) {
-        for (int col_count=0; col_count < original->cols; col_count++) {
-            double ele = get_element(original, row_count, col_count);
-            set_element(&copy, row_count, col_count, ele);
+    Matrix copy = create_uninitialised_matrix(original->rows, original->cols, original->layout);
+    copy_matrix_into(&copy, original);
+
+    return copy;
+}
+
+void copy_matrix_into(Matrix* result, const Matrix* original) {
+    if (result->rows != original->rows || result->cols != original->cols) {
+        printf("Incompatible dimensions for matrix copy.\n");
+        return;
+    }
+
+    // Copies the elements of a matrix into an existing matrix with the same dimensions.
+    if (result->data == original->data && same_layout(result, original)) {
+        return;
+    }
+
+    // Converting between layouts copies an element at a time, visiting the result in its storage order.
+    if (!same_layout(result, original)) {
+        Matrix result_view = matrix_storage_view(result);
+        for (int line=0; line < result_view.rows; line++) {
+            Scalar* out = row_address(&result_view, line);
+            for (int i=0; i < result_view.cols; i++) {
+                int row = (result->layout == MATRIX_COL_MAJOR) ? i : line;
+                int col = (result->layout == MATRIX_COL_MAJOR) ? line : i;
+                out[i] = original->data[element_index(original, row, col)];
+            }
         }
+        return;
     }
 
-    return copy;
+    if (is_contiguous(result) && is_contiguous(original)) {
+        memcpy(result->data, original->data, (size_t)original->rows * original->cols * sizeof(Scalar));
+        return;
+    }
+
+    Matrix result_view = matrix_storage_view(result);
+    Matrix original_view = matrix_storage_view(original);
+    for (int row_count=0; row_count < original_view.rows; row_count++) {
+        memcpy(row_address(&result_view, row_count), row_address(&original_view, row_count),
+            original_view.cols * sizeof(Scalar));
+    }
 }
 
-void set_element(Matrix* matrix, int row, int col, double data_item) {
+void set_element(Matrix* matrix, int row, int col, Scalar data_item) {
     // Sets the value of the specified element of a matrix.
-    matrix->data[(row * matrix->cols) + col] = data_item;
+    matrix->data[element_index(matrix, row, col)] = data_item;
 }
 
-double get_element(const Matrix* matrix, int row, int col) {
+Scalar get_element(const Matrix* matrix, int row, int col) {
     // Returns the value of the specified element of a matrix.
-    return matrix->data[(row * matrix->cols) + col];
+    return matrix->data[element_index(matrix, row, col)];
 }
 
 Matrix matrix_addition(const Matrix* matrix_a, const Matrix* matrix_b) {
@@ -72,19 +252,55 @@ Matrix matrix_addition(const Matrix* matrix_a, const Matrix* matrix_b) {
     }
 
     // Calculates and returns the resulting matrix from adding the two matrices.
-    Matrix result = create_matrix(matrix_a->rows, matrix_a->cols);
+    Matrix result = create_uninitialised_matrix(matrix_a->rows, matrix_a->cols, matrix_a->layout);
+    matrix_addition_into(&result, matrix_a, matrix_b);
+
+    return result;
+}
+
+void matrix_addition_into(Matrix* result, const Matrix* matrix_a, const Matrix* matrix_b) {
+    // Error handling for matrices that do not all have the same dimensions.
+    if (matrix_a->rows != matrix_b->rows || matrix_a->cols != matrix_b->cols || 
+        result->rows != matrix_a->rows || result->cols != matrix_a->cols) {
+        printf("Incompatible dimensions for matrix addition.\n");
+        return;
+    }
+
+    // Writes the sum of the two matrices into the result matrix.
+    apply_binary_kernel(get_simd_kernels()->add, result, matrix_a, matrix_b);
+}
 
-    for (int row_count=0; row_count < matrix_a->rows; row_count++) {
-        for (int col_count=0; col_count < matrix_a->cols; col_count++) {
-            double ele_a = get_element(matrix_a, row_count, col_count);
-            double ele_b = get_element(matrix_b, row_count, col_count);
-            double ele_result = ele_a + ele_b;
+void matrix_axpy(Matrix* matrix_y, Scalar alpha, const Matrix* matrix_x) {
+    // Error handling for matrices that do not have the same dimensions.
+    if (matrix_y->rows != matrix_x->rows || matrix_y->cols != matrix_x->cols) {
+        printf("Incompatible dimensions for matrix axpy.\n");
+        return;
+    }
 
-            set_element(&result, row_count, col_count, ele_result);
+    // Adds alpha * X to Y, in place.
+    const SimdKernels* kernels = get_simd_kernels();
+    if (!same_layout(matrix_y, matrix_x)) {
+        for (int row_count=0; row_count < matrix_y->rows; row_count++) {
+            for (int col_count=0; col_count < matrix_y->cols; col_count++) {
+                kernels->axpy(alpha, &matrix_x->data[element_index(matrix_x, row_count, col_count)],
+                    &matrix_y->data[element_index(matrix_y, row_count, col_count)], 1);
+            }
         }
+        return;
     }
 
-    return result;
+    Matrix y_view = matrix_storage_view(matrix_y);
+    Matrix x_view = matrix_storage_view(matrix_x);
+    matrix_y = &y_view;
+    matrix_x = &x_view;
+    if (is_contiguous(matrix_y) && is_contiguous(matrix_x)) {
+        kernels->axpy(alpha, matrix_x->data, matrix_y->data, matrix_y->rows * matrix_y->cols);
+        return;
+    }
+
+    for (int row_count=0; row_count < matrix_y->rows; row_count++) {
+        kernels->axpy(alpha, row_address(matrix_x, row_count), row_address(matrix_y, row_count), matrix_y->cols);
+    }
 }
 
 Matrix matrix_multiplication(const Matrix* matrix_a, const Matrix* matrix_b) {
@@ -95,32 +311,147 @@ Matrix matrix_multiplication(const Matrix* matrix_a, const Matrix* matrix_b) {
     }
 
     // Calculates and returns the resulting matrix from multiplying the two matrices.
-    Matrix result = create_matrix(matrix_a->rows, matrix_b->cols);
+    Matrix result = create_uninitialised_matrix(matrix_a->rows, matrix_b->cols, matrix_a->layout);
+    matrix_multiplication_into(&result, matrix_a, matrix_b);
 
-    for (int i=0; i < matrix_a->rows; i++) {
-        for (int j=0; j < matrix_b->cols; j++) {
-            double ele = 0;
-            for (int k=0; k < matrix_a->cols; k++) {
-                ele += get_element(matrix_a, i, k) * get_element(matrix_b, k, j);
-            }
-            set_element(&result, i, j, ele);
-        }
+    return result;
+}
+
+static GemmTranspose gemm_transpose(const Matrix* matrix, int transpose) {
+    // gemm reads its buffers as row-major, and a column-major matrix's buffer read that way is its transpose,
+    // so column-major operands are read with the opposite of their transpose flag.
+    return ((matrix->layout == MATRIX_COL_MAJOR) != (transpose != 0)) ? GEMM_TRANS : GEMM_NO_TRANS;
+}
+
+static GemmTranspose flip_transpose(GemmTranspose trans) {
+    return (trans == GEMM_TRANS) ? GEMM_NO_TRANS : GEMM_TRANS;
+}
+
+void matrix_multiplication_into(Matrix* result, const Matrix* matrix_a, const Matrix* matrix_b) {
+    matrix_multiplication_transposed_into(result, matrix_a, 0, matrix_b, 0);
+}
+
+Matrix matrix_multiplication_transposed(const Matrix* matrix_a, int transpose_a, const Matrix* matrix_b,
+    int transpose_b) {
+    // Dimensions of op(A) and op(B), where op transposes the matrix if its flag is set.
+    int a_rows = transpose_a ? matrix_a->cols : matrix_a->rows;
+    int a_cols = transpose_a ? matrix_a->rows : matrix_a->cols;
+    int b_rows = transpose_b ? matrix_b->cols : matrix_b->rows;
+    int b_cols = transpose_b ? matrix_b->rows : matrix_b->cols;
+
+    // Error handling for matrices that cannot be multiplied together. 
+    if (a_cols != b_rows) {
+        printf("Incompatible dimensions for matrix multiplication.\n");
+        return empty_matrix();
     }
 
+    // Calculates and returns op(A) * op(B), reading transposed operands in place rather than copying them.
+    Matrix result = create_uninitialised_matrix(a_rows, b_cols, matrix_a->layout);
+    matrix_multiplication_transposed_into(&result, matrix_a, transpose_a, matrix_b, transpose_b);
+
     return result;
 }
 
-Matrix matrix_scalar_multiplication(const Matrix* matrix, double multiplier) {
+void matrix_multiplication_transposed_into(Matrix* result, const Matrix* matrix_a, int transpose_a,
+    const Matrix* matrix_b, int transpose_b) {
+    int a_rows = transpose_a ? matrix_a->cols : matrix_a->rows;
+    int a_cols = transpose_a ? matrix_a->rows : matrix_a->cols;
+    int b_rows = transpose_b ? matrix_b->cols : matrix_b->rows;
+    int b_cols = transpose_b ? matrix_b->rows : matrix_b->cols;
+
+    // Error handling for matrices that cannot be multiplied together, or a result of the wrong size.
+    if (a_cols != b_rows || result->rows != a_rows || result->cols != b_cols) {
+        printf("Incompatible dimensions for matrix multiplication.\n");
+        return;
+    }
+
+    // The product itself is computed by the blocked GEMM kernel in gemm.c. A column-major result's buffer holds
+    // its transpose as row-major, so that is computed instead, as op(B)^T * op(A)^T.
+    GemmTranspose trans_a = gemm_transpose(matrix_a, transpose_a);
+    GemmTranspose trans_b = gemm_transpose(matrix_b, transpose_b);
+    if (result->layout == MATRIX_COL_MAJOR) {
+        gemm(flip_transpose(trans_b), flip_transpose(trans_a), result->cols, result->rows, a_cols, matrix_b->data,
+            matrix_b->stride, matrix_a->data, matrix_a->stride, result->data, result->stride);
+    }
+    else {
+        gemm(trans_a, trans_b, result->rows, result->cols, a_cols, matrix_a->data, matrix_a->stride, matrix_b->data,
+            matrix_b->stride, result->data, result->stride);
+    }
+}
+
+void matrix_multiplication_bias_func_into(Matrix* z, Matrix* a, const Matrix* matrix_a, const Matrix* matrix_b,
+    const Matrix* bias, void (*func)(const Scalar* in, Scalar* out, int n)) {
+    // Error handling for matrices that cannot be multiplied together, or results or a bias of the wrong size.
+    if (matrix_a->cols != matrix_b->rows || z->rows != matrix_a->rows || z->cols != matrix_b->cols ||
+        bias->rows != z->rows || bias->cols != 1 ||
+        (func != NULL && (a->rows != z->rows || a->cols != z->cols))) {
+        printf("Incompatible dimensions for matrix multiplication.\n");
+        return;
+    }
+    if (func != NULL && !same_layout(a, z)) {
+        printf("Incompatible layouts for matrix multiplication.\n");
+        return;
+    }
+
+    // Distance between consecutive elements of the bias vector.
+    int bias_step = (bias->layout == MATRIX_COL_MAJOR) ? 1 : bias->stride;
+    GemmTranspose trans_a = gemm_transpose(matrix_a, 0);
+    GemmTranspose trans_b = gemm_transpose(matrix_b, 0);
+
+    // As in matrix_multiplication_transposed_into, a column-major z is computed as its transpose, to which the
+    // bias is added along its rows rather than down its columns.
+    if (z->layout == MATRIX_COL_MAJOR) {
+        GemmEpilogue epilogue = {NULL, bias->data, bias_step, func, (func != NULL) ? a->data : NULL,
+            (func != NULL) ? a->stride : 0};
+        gemm_epilogue(flip_transpose(trans_b), flip_transpose(trans_a), z->cols, z->rows, matrix_a->cols,
+            matrix_b->data, matrix_b->stride, matrix_a->data, matrix_a->stride, z->data, z->stride, &epilogue);
+    }
+    else {
+        GemmEpilogue epilogue = {bias->data, NULL, bias_step, func, (func != NULL) ? a->data : NULL,
+            (func != NULL) ? a->stride : 0};
+        gemm_epilogue(trans_a, trans_b, z->rows, z->cols, matrix_a->cols, matrix_a->data, matrix_a->stride,
+            matrix_b->data, matrix_b->stride, z->data, z->stride, &epilogue);
+    }
+}
+
+Matrix matrix_scalar_multiplication(const Matrix* matrix, Scalar multiplier) {
     // Multiplies each element in a matrix by a scalar value.
-    Matrix result = create_matrix(matrix->rows, matrix->cols);
-    for (int row_count=0; row_count < matrix->rows; row_count++) {
-        for (int col_count=0; col_count < matrix->cols; col_count++) {
-            double ele = get_element(matrix, row_count, col_count);
-            set_element(&result, row_count, col_count, ele * multiplier);
+    Matrix result = create_uninitialised_matrix(matrix->rows, matrix->cols, matrix->layout);
+    matrix_scalar_multiplication_into(&result, matrix, multiplier);
+
+    return result;
+}
+
+void matrix_scalar_multiplication_into(Matrix* result, const Matrix* matrix, Scalar multiplier) {
+    if (result->rows != matrix->rows || result->cols != matrix->cols) {
+        printf("Incompatible dimensions for scalar multiplication.\n");
+        return;
+    }
+
+    // Writes each element of a matrix multiplied by a scalar value into the result matrix.
+    const SimdKernels* kernels = get_simd_kernels();
+    if (!same_layout(result, matrix)) {
+        for (int row_count=0; row_count < result->rows; row_count++) {
+            for (int col_count=0; col_count < result->cols; col_count++) {
+                kernels->scale(&matrix->data[element_index(matrix, row_count, col_count)], multiplier,
+                    &result->data[element_index(result, row_count, col_count)], 1);
+            }
         }
+        return;
     }
 
-    return result;
+    Matrix result_view = matrix_storage_view(result);
+    Matrix input_view = matrix_storage_view(matrix);
+    result = &result_view;
+    matrix = &input_view;
+    if (is_contiguous(result) && is_contiguous(matrix)) {
+        kernels->scale(matrix->data, multiplier, result->data, result->rows * result->cols);
+        return;
+    }
+
+    for (int row_count=0; row_count < result->rows; row_count++) {
+        kernels->scale(row_address(matrix, row_count), multiplier, row_address(result, row_count), result->cols);
+    }
 }
 
 Matrix hadamard_product(const Matrix* matrix_a, const Matrix* matrix_b) {
@@ -131,38 +462,22 @@ Matrix hadamard_product(const Matrix* matrix_a, const Matrix* matrix_b) {
     }
 
     // Calculates and returns the resulting matrix from performing the Hadamard product of two matrices.
-    Matrix result = create_matrix(matrix_a->rows, matrix_a->cols);
-
-    for (int row_count=0; row_count < matrix_a->rows; row_count++) {
-        for (int col_count=0; col_count < matrix_a->cols; col_count++) {
-            double ele_a = get_element(matrix_a, row_count, col_count);
-            double ele_b = get_element(matrix_b, row_count, col_count);
-            double ele_result = ele_a * ele_b;
-
-            set_element(&result, row_count, col_count, ele_result);
-        }
-    }
+    Matrix result = create_uninitialised_matrix(matrix_a->rows, matrix_a->cols, matrix_a->layout);
+    hadamard_product_into(&result, matrix_a, matrix_b);
 
     return result;
 }
 
-static Matrix broadcast(const Matrix* matrix, int rows, int cols) {
-    if (matrix->rows == rows && matrix->cols == cols) {
-        return copy_matrix(matrix);
-    }
-
-    Matrix result = create_matrix(rows, cols);
-    for (int row_count=0; row_count < rows; row_count++) {
-        for (int col_count=0; col_count < cols; col_count++) {
-            int source_row = (matrix->rows == 1) ? 0 : row_count;
-            int source_col = (matrix->cols == 1) ? 0 : col_count;
-
-            double ele = get_element(matrix, source_row, source_col);
-            set_element(&result, row_count, col_count, ele);
-        }
+void hadamard_product_into(Matrix* result, const Matrix* matrix_a, const Matrix* matrix_b) {
+    // Error handling for matrices that do not all have the same dimensions.
+    if (matrix_a->rows != matrix_b->rows || matrix_a->cols != matrix_b->cols ||
+        result->rows != matrix_a->rows || result->cols != matrix_a->cols) {
+        printf("Incompatible dimensions for Hadamard product.\n");
+        return;
     }
 
-    return result;
+    // Writes the Hadamard product of two matrices into the result matrix.
+    apply_binary_kernel(get_simd_kernels()->multiply, result, matrix_a, matrix_b);
 }
 
 Matrix matrix_broadcast_addition(const Matrix* matrix_a, const Matrix* matrix_b) {
@@ -177,25 +492,76 @@ Matrix matrix_broadcast_addition(const Matrix* matrix_a, const Matrix* matrix_b)
     int rows = (matrix_a->rows > matrix_b->rows) ? matrix_a->rows : matrix_b->rows;
     int cols = (matrix_a->cols > matrix_b->cols) ? matrix_a->cols : matrix_b->cols;
 
-    Matrix broadcasted_a, broadcasted_b;
-    broadcasted_a = broadcast(matrix_a, rows, cols);
-    broadcasted_b = broadcast(matrix_b, rows, cols);
-
-    Matrix result = matrix_addition(&broadcasted_a, &broadcasted_b);
-
-    free_matrix(&broadcasted_a);
-    free_matrix(&broadcasted_b);
+    Matrix result = create_uninitialised_matrix(rows, cols, matrix_a->layout);
+    matrix_broadcast_addition_into(&result, matrix_a, matrix_b);
     
     return result;
 }
 
+void matrix_broadcast_addition_into(Matrix* result, const Matrix* matrix_a, const Matrix* matrix_b) {
+    int rows_compatible = (matrix_a->rows == matrix_b->rows || matrix_a->rows == 1 || matrix_b->rows == 1);
+    int cols_compatible = (matrix_a->cols == matrix_b->cols || matrix_a->cols == 1 || matrix_b->cols == 1);
+    int rows = (matrix_a->rows > matrix_b->rows) ? matrix_a->rows : matrix_b->rows;
+    int cols = (matrix_a->cols > matrix_b->cols) ? matrix_a->cols : matrix_b->cols;
+    if (!rows_compatible || !cols_compatible || result->rows != rows || result->cols != cols) {
+        printf("Incompatible dimensions for broadcasting");
+        return;
+    }
+
+    // Matrices of different layouts are added an element at a time.
+    if (!same_layout(result, matrix_a) || !same_layout(result, matrix_b)) {
+        for (int row_count=0; row_count < rows; row_count++) {
+            for (int col_count=0; col_count < cols; col_count++) {
+                Scalar a_ele = get_element(matrix_a, (matrix_a->rows == 1) ? 0 : row_count,
+                    (matrix_a->cols == 1) ? 0 : col_count);
+                Scalar b_ele = get_element(matrix_b, (matrix_b->rows == 1) ? 0 : row_count,
+                    (matrix_b->cols == 1) ? 0 : col_count);
+                set_element(result, row_count, col_count, a_ele + b_ele);
+            }
+        }
+        return;
+    }
+
+    // Column-major matrices are added through their storage views, in which a column vector being broadcast
+    // becomes a single row.
+    Matrix result_view = matrix_storage_view(result);
+    Matrix a_view = matrix_storage_view(matrix_a);
+    Matrix b_view = matrix_storage_view(matrix_b);
+    result = &result_view;
+    matrix_a = &a_view;
+    matrix_b = &b_view;
+    rows = result->rows;
+    cols = result->cols;
+
+    const SimdKernels* kernels = get_simd_kernels();
+
+    // Neither operand is expanded to the full size: each row of the result is the sum of the matching rows
+    // of the operands (or their only row), where a single-column row is added as a scalar. The result may be
+    // the same matrix as a full-size operand.
+    for (int row_count=0; row_count < rows; row_count++) {
+        const Scalar* row_a = row_address(matrix_a, (matrix_a->rows == 1) ? 0 : row_count);
+        const Scalar* row_b = row_address(matrix_b, (matrix_b->rows == 1) ? 0 : row_count);
+        Scalar* row_result = row_address(result, row_count);
+
+        if (matrix_a->cols == cols && matrix_b->cols == cols) {
+            kernels->add(row_a, row_b, row_result, cols);
+        }
+        else if (matrix_b->cols == 1) {
+            kernels->add_scalar(row_a, row_b[0], row_result, cols);
+        }
+        else {
+            kernels->add_scalar(row_b, row_a[0], row_result, cols);
+        }
+    }
+}
+
 Matrix transpose(const Matrix* matrix) {
     // Constructs and returns the transpose of the matrix.
-    Matrix result = create_matrix(matrix->cols, matrix->rows);
+    Matrix result = create_uninitialised_matrix(matrix->cols, matrix->rows, matrix->layout);
 
     for (int row_count=0; row_count < matrix->rows; row_count++) {
         for (int col_count=0; col_count < matrix->cols; col_count++) {
-            double ele = get_element(matrix, row_count, col_count);
+            Scalar ele = get_element(matrix, row_count, col_count);
             set_element(&result, col_count, row_count, ele);
         }
     } 
@@ -203,13 +569,37 @@ Matrix transpose(const Matrix* matrix) {
     return result;
 }
 
-void apply_func(Matrix* matrix, double (*func)(double)) {
+void apply_func(Matrix* matrix, Scalar (*func)(Scalar)) {
     // Applies a given function to each element in a matrix.
+    apply_func_into(matrix, matrix, func);
+}
+
+void apply_func_into(Matrix* result, const Matrix* matrix, Scalar (*func)(Scalar)) {
+    if (result->rows != matrix->rows || result->cols != matrix->cols) {
+        printf("Incompatible dimensions for applying function.\n");
+        return;
+    }
+
+    if (!same_layout(result, matrix)) {
+        for (int row_count=0; row_count < matrix->rows; row_count++) {
+            for (int col_count=0; col_count < matrix->cols; col_count++) {
+                set_element(result, row_count, col_count, func(get_element(matrix, row_count, col_count)));
+            }
+        }
+        return;
+    }
+
+    // Writes the given function of each element in a matrix into the result matrix. Elements are visited in
+    // storage order, a row (or column) at a time, without any per-element index arithmetic.
+    Matrix result_view = matrix_storage_view(result);
+    Matrix input_view = matrix_storage_view(matrix);
+    result = &result_view;
+    matrix = &input_view;
     for (int row_count=0; row_count < matrix->rows; row_count++) {
+        const Scalar* in = row_address(matrix, row_count);
+        Scalar* out = row_address(result, row_count);
         for (int col_count=0; col_count < matrix->cols; col_count++) {
-            double in = get_element(matrix, row_count, col_count);
-            double out = func(in);
-            set_element(matrix, row_count, col_count, out);
+            out[col_count] = func(in[col_count]);
         }
     }
 }
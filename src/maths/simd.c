@@ -0,0 +1,452 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tgmath.h>
+#include "maths/simd.h"
+#include "maths/fast_math.h"
+#include "maths/fast_math_priv.h"
+
+static void add_scalar_level(const Scalar* a, const Scalar* b, Scalar* out, int n) {
+    for (int i=0; i < n; i++) {
+        out[i] = a[i] + b[i];
+    }
+}
+
+static void multiply_scalar_level(const Scalar* a, const Scalar* b, Scalar* out, int n) {
+    for (int i=0; i < n; i++) {
+        out[i] = a[i] * b[i];
+    }
+}
+
+static void scale_scalar_level(const Scalar* a, Scalar scalar, Scalar* out, int n) {
+    for (int i=0; i < n; i++) {
+        out[i] = a[i] * scalar;
+    }
+}
+
+static void add_scalar_scalar_level(const Scalar* a, Scalar scalar, Scalar* out, int n) {
+    for (int i=0; i < n; i++) {
+        out[i] = a[i] + scalar;
+    }
+}
+
+static void axpy_scalar_level(Scalar alpha, const Scalar* x, Scalar* y, int n) {
+    for (int i=0; i < n; i++) {
+        y[i] += alpha * x[i];
+    }
+}
+
+static void momentum_update_scalar_level(Scalar* w, const Scalar* g, Scalar* v, Scalar lr, Scalar momentum,
+    int nesterov, int n) {
+    for (int i=0; i < n; i++) {
+        v[i] = momentum * v[i] + g[i];
+        w[i] -= lr * (nesterov ? g[i] + momentum * v[i] : v[i]);
+    }
+}
+
+static void adam_update_scalar_level(Scalar* w, const Scalar* g, Scalar* m, Scalar* v, Scalar beta1, Scalar beta2,
+    Scalar step_size, Scalar epsilon, int n) {
+    for (int i=0; i < n; i++) {
+        m[i] = beta1 * m[i] + (1 - beta1) * g[i];
+        v[i] = beta2 * v[i] + (1 - beta2) * g[i] * g[i];
+        w[i] -= step_size * m[i] / (sqrt(v[i]) + epsilon);
+    }
+}
+
+static void relu_scalar_level(const Scalar* a, Scalar* out, int n) {
+    for (int i=0; i < n; i++) {
+        out[i] = (a[i] > 0) ? a[i] : 0;
+    }
+}
+
+static void sigmoid_backward_scalar_level(const Scalar* a, const Scalar* g, Scalar* out, int n) {
+    for (int i=0; i < n; i++) {
+        out[i] = g[i] * (a[i] * (1 - a[i]));
+    }
+}
+
+static void tanh_backward_scalar_level(const Scalar* a, const Scalar* g, Scalar* out, int n) {
+    for (int i=0; i < n; i++) {
+        out[i] = g[i] * (1 - a[i] * a[i]);
+    }
+}
+
+static void relu_backward_scalar_level(const Scalar* a, const Scalar* g, Scalar* out, int n) {
+    for (int i=0; i < n; i++) {
+        out[i] = (a[i] > 0) ? g[i] : 0;
+    }
+}
+
+static void fast_exp_scalar_level(const Scalar* a, Scalar* out, int n) {
+    for (int i=0; i < n; i++) {
+        out[i] = fast_exp(a[i]);
+    }
+}
+
+static void fast_log_scalar_level(const Scalar* a, Scalar* out, int n) {
+    for (int i=0; i < n; i++) {
+        out[i] = fast_log(a[i]);
+    }
+}
+
+static void fast_sigmoid_scalar_level(const Scalar* a, Scalar* out, int n) {
+    for (int i=0; i < n; i++) {
+        out[i] = fast_sigmoid(a[i]);
+    }
+}
+
+static void fast_tanh_scalar_level(const Scalar* a, Scalar* out, int n) {
+    for (int i=0; i < n; i++) {
+        out[i] = fast_tanh(a[i]);
+    }
+}
+
+static const SimdKernels scalar_kernels = {SIMD_SCALAR, "scalar", &add_scalar_level, &multiply_scalar_level,
+    &scale_scalar_level, &add_scalar_scalar_level, &axpy_scalar_level, &momentum_update_scalar_level,
+    &adam_update_scalar_level, &relu_scalar_level, &sigmoid_backward_scalar_level, &tanh_backward_scalar_level,
+    &relu_backward_scalar_level, &fast_exp_scalar_level, &fast_log_scalar_level, &fast_sigmoid_scalar_level,
+    &fast_tanh_scalar_level};
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// Defines the element-wise kernels for one instruction set, using vectors of `bytes` bytes, which hold half
+// as many doubles as floats. The body of each kernel is identical across instruction sets, so only the target
+// attribute and the vector width change; the vector types are unaligned so that kernels can be run on any
+// sub-range of a matrix. Remaining elements that do not fill a whole vector are handled one at a time.
+#define DEFINE_SIMD_KERNELS(suffix, target_isa, bytes) \
+    typedef Scalar vec_##suffix __attribute__((vector_size(bytes), aligned(sizeof(Scalar)), may_alias)); \
+    enum { width_##suffix = (bytes) / sizeof(Scalar) }; \
+    \
+    __attribute__((target(target_isa))) \
+    static void add_##suffix(const Scalar* a, const Scalar* b, Scalar* out, int n) { \
+        int i = 0; \
+        for (; i + width_##suffix <= n; i += width_##suffix) { \
+            *(vec_##suffix*)&out[i] = *(const vec_##suffix*)&a[i] + *(const vec_##suffix*)&b[i]; \
+        } \
+        for (; i < n; i++) { \
+            out[i] = a[i] + b[i]; \
+        } \
+    } \
+    \
+    __attribute__((target(target_isa))) \
+    static void multiply_##suffix(const Scalar* a, const Scalar* b, Scalar* out, int n) { \
+        int i = 0; \
+        for (; i + width_##suffix <= n; i += width_##suffix) { \
+            *(vec_##suffix*)&out[i] = *(const vec_##suffix*)&a[i] * *(const vec_##suffix*)&b[i]; \
+        } \
+        for (; i < n; i++) { \
+            out[i] = a[i] * b[i]; \
+        } \
+    } \
+    \
+    __attribute__((target(target_isa))) \
+    static void scale_##suffix(const Scalar* a, Scalar scalar, Scalar* out, int n) { \
+        int i = 0; \
+        for (; i + width_##suffix <= n; i += width_##suffix) { \
+            *(vec_##suffix*)&out[i] = *(const vec_##suffix*)&a[i] * scalar; \
+        } \
+        for (; i < n; i++) { \
+            out[i] = a[i] * scalar; \
+        } \
+    } \
+    \
+    __attribute__((target(target_isa))) \
+    static void add_scalar_##suffix(const Scalar* a, Scalar scalar, Scalar* out, int n) { \
+        int i = 0; \
+        for (; i + width_##suffix <= n; i += width_##suffix) { \
+            *(vec_##suffix*)&out[i] = *(const vec_##suffix*)&a[i] + scalar; \
+        } \
+        for (; i < n; i++) { \
+            out[i] = a[i] + scalar; \
+        } \
+    } \
+    \
+    __attribute__((target(target_isa))) \
+    static void axpy_##suffix(Scalar alpha, const Scalar* x, Scalar* y, int n) { \
+        int i = 0; \
+        for (; i + width_##suffix <= n; i += width_##suffix) { \
+            *(vec_##suffix*)&y[i] += alpha * *(const vec_##suffix*)&x[i]; \
+        } \
+        for (; i < n; i++) { \
+            y[i] += alpha * x[i]; \
+        } \
+    } \
+    \
+    __attribute__((target(target_isa))) \
+    static void momentum_update_##suffix(Scalar* w, const Scalar* g, Scalar* v, Scalar lr, Scalar momentum, \
+        int nesterov, int n) { \
+        int i = 0; \
+        for (; i + width_##suffix <= n; i += width_##suffix) { \
+            vec_##suffix grad = *(const vec_##suffix*)&g[i]; \
+            vec_##suffix velocity = momentum * *(vec_##suffix*)&v[i] + grad; \
+            *(vec_##suffix*)&v[i] = velocity; \
+            vec_##suffix step = velocity; \
+            if (nesterov) { \
+                step = grad + momentum * velocity; \
+            } \
+            *(vec_##suffix*)&w[i] -= lr * step; \
+        } \
+        for (; i < n; i++) { \
+            v[i] = momentum * v[i] + g[i]; \
+            w[i] -= lr * (nesterov ? g[i] + momentum * v[i] : v[i]); \
+        } \
+    } \
+    \
+    __attribute__((target(target_isa))) \
+    static void adam_update_##suffix(Scalar* w, const Scalar* g, Scalar* m, Scalar* v, Scalar beta1, \
+        Scalar beta2, Scalar step_size, Scalar epsilon, int n) { \
+        int i = 0; \
+        for (; i + width_##suffix <= n; i += width_##suffix) { \
+            vec_##suffix grad = *(const vec_##suffix*)&g[i]; \
+            vec_##suffix first = beta1 * *(vec_##suffix*)&m[i] + (1 - beta1) * grad; \
+            vec_##suffix second = beta2 * *(vec_##suffix*)&v[i] + (1 - beta2) * grad * grad; \
+            *(vec_##suffix*)&m[i] = first; \
+            *(vec_##suffix*)&v[i] = second; \
+            /* Vector extensions have no square root, but a loop over the lanes compiles to one instruction. */ \
+            vec_##suffix root; \
+            for (int lane=0; lane < width_##suffix; lane++) { \
+                root[lane] = sqrt(second[lane]); \
+            } \
+            *(vec_##suffix*)&w[i] -= step_size * first / (root + epsilon); \
+        } \
+        for (; i < n; i++) { \
+            m[i] = beta1 * m[i] + (1 - beta1) * g[i]; \
+            v[i] = beta2 * v[i] + (1 - beta2) * g[i] * g[i]; \
+            w[i] -= step_size * m[i] / (sqrt(v[i]) + epsilon); \
+        } \
+    } \
+    \
+    /* C has no conditional operator for vectors, so the selects below mask the bits of the chosen value with */ \
+    /* the result of a comparison, which is all ones in lanes where it holds and all zeros elsewhere. */ \
+    __attribute__((target(target_isa))) \
+    static void relu_##suffix(const Scalar* a, Scalar* out, int n) { \
+        int i = 0; \
+        for (; i + width_##suffix <= n; i += width_##suffix) { \
+            vec_##suffix x = *(const vec_##suffix*)&a[i]; \
+            __typeof__(x > 0) positive = x > 0; \
+            *(vec_##suffix*)&out[i] = (vec_##suffix)((__typeof__(positive))x & positive); \
+        } \
+        for (; i < n; i++) { \
+            out[i] = (a[i] > 0) ? a[i] : 0; \
+        } \
+    } \
+    \
+    __attribute__((target(target_isa))) \
+    static void sigmoid_backward_##suffix(const Scalar* a, const Scalar* g, Scalar* out, int n) { \
+        int i = 0; \
+        for (; i + width_##suffix <= n; i += width_##suffix) { \
+            vec_##suffix x = *(const vec_##suffix*)&a[i]; \
+            *(vec_##suffix*)&out[i] = *(const vec_##suffix*)&g[i] * (x * (1 - x)); \
+        } \
+        for (; i < n; i++) { \
+            out[i] = g[i] * (a[i] * (1 - a[i])); \
+        } \
+    } \
+    \
+    __attribute__((target(target_isa))) \
+    static void tanh_backward_##suffix(const Scalar* a, const Scalar* g, Scalar* out, int n) { \
+        int i = 0; \
+        for (; i + width_##suffix <= n; i += width_##suffix) { \
+            vec_##suffix x = *(const vec_##suffix*)&a[i]; \
+            *(vec_##suffix*)&out[i] = *(const vec_##suffix*)&g[i] * (1 - x * x); \
+        } \
+        for (; i < n; i++) { \
+            out[i] = g[i] * (1 - a[i] * a[i]); \
+        } \
+    } \
+    \
+    __attribute__((target(target_isa))) \
+    static void relu_backward_##suffix(const Scalar* a, const Scalar* g, Scalar* out, int n) { \
+        int i = 0; \
+        for (; i + width_##suffix <= n; i += width_##suffix) { \
+            vec_##suffix x = *(const vec_##suffix*)&a[i]; \
+            __typeof__(x > 0) positive = x > 0; \
+            *(vec_##suffix*)&out[i] = (vec_##suffix)((__typeof__(positive))*(const vec_##suffix*)&g[i] & positive); \
+        } \
+        for (; i < n; i++) { \
+            out[i] = (a[i] > 0) ? g[i] : 0; \
+        } \
+    } \
+    \
+    /* The approximations follow the steps of the scalar forms in fast_math.c, with the same constants. */ \
+    typedef __typeof__(*(vec_##suffix*)0 > 0) bits_##suffix; \
+    \
+    __attribute__((target(target_isa))) \
+    static inline vec_##suffix select_##suffix(bits_##suffix mask, vec_##suffix a, vec_##suffix b) { \
+        /* a in lanes where mask is set, and b elsewhere */ \
+        return (vec_##suffix)(((bits_##suffix)a & mask) | ((bits_##suffix)b & ~mask)); \
+    } \
+    \
+    __attribute__((target(target_isa))) \
+    static inline vec_##suffix exp_vec_##suffix(vec_##suffix x) { \
+        bits_##suffix overflow = x > FAST_EXP_MAX; \
+        bits_##suffix underflow = x < FAST_EXP_MIN; \
+        x = select_##suffix(overflow | underflow, (vec_##suffix){0}, x); \
+        vec_##suffix shifted = x * (Scalar)FAST_MATH_LOG2E + FAST_MATH_ROUNDING_MAGIC; \
+        vec_##suffix k = shifted - FAST_MATH_ROUNDING_MAGIC; \
+        vec_##suffix r = (x - k * (Scalar)FAST_MATH_LN2_HI) - k * (Scalar)FAST_MATH_LN2_LO; \
+        vec_##suffix p = (vec_##suffix){0} + fast_exp_coefficients[FAST_EXP_DEGREE]; \
+        for (int c=FAST_EXP_DEGREE-1; c >= 0; c--) { \
+            p = p * r + fast_exp_coefficients[c]; \
+        } \
+        bits_##suffix k_bits = (bits_##suffix)shifted - FAST_MATH_ROUNDING_MAGIC_BITS; \
+        vec_##suffix result = p * (vec_##suffix)((k_bits + FAST_MATH_EXPONENT_BIAS) << FAST_MATH_MANTISSA_BITS); \
+        result = (vec_##suffix)((bits_##suffix)result & ~underflow); \
+        return select_##suffix(overflow, (vec_##suffix){0} + (Scalar)INFINITY, result); \
+    } \
+    \
+    __attribute__((target(target_isa))) \
+    static void fast_exp_##suffix(const Scalar* a, Scalar* out, int n) { \
+        int i = 0; \
+        for (; i + width_##suffix <= n; i += width_##suffix) { \
+            *(vec_##suffix*)&out[i] = exp_vec_##suffix(*(const vec_##suffix*)&a[i]); \
+        } \
+        for (; i < n; i++) { \
+            out[i] = fast_exp(a[i]); \
+        } \
+    } \
+    \
+    __attribute__((target(target_isa))) \
+    static void fast_log_##suffix(const Scalar* a, Scalar* out, int n) { \
+        int i = 0; \
+        for (; i + width_##suffix <= n; i += width_##suffix) { \
+            bits_##suffix bits = (bits_##suffix)*(const vec_##suffix*)&a[i]; \
+            bits_##suffix e = (bits - FAST_MATH_SQRT_HALF_BITS) >> FAST_MATH_MANTISSA_BITS; \
+            vec_##suffix m = (vec_##suffix)(bits - (e << FAST_MATH_MANTISSA_BITS)); \
+            vec_##suffix s = (m - 1) / (m + 1); \
+            vec_##suffix s2 = s * s; \
+            vec_##suffix q = (vec_##suffix){0} + fast_log_coefficients[FAST_LOG_TERMS-1]; \
+            for (int c=FAST_LOG_TERMS-2; c >= 0; c--) { \
+                q = q * s2 + fast_log_coefficients[c]; \
+            } \
+            vec_##suffix e_scalar = (vec_##suffix)(e + FAST_MATH_ROUNDING_MAGIC_BITS) - FAST_MATH_ROUNDING_MAGIC; \
+            *(vec_##suffix*)&out[i] = e_scalar * (Scalar)FAST_MATH_LN2_HI + \
+                (s * q + e_scalar * (Scalar)FAST_MATH_LN2_LO); \
+        } \
+        for (; i < n; i++) { \
+            out[i] = fast_log(a[i]); \
+        } \
+    } \
+    \
+    __attribute__((target(target_isa))) \
+    static void fast_sigmoid_##suffix(const Scalar* a, Scalar* out, int n) { \
+        int i = 0; \
+        for (; i + width_##suffix <= n; i += width_##suffix) { \
+            *(vec_##suffix*)&out[i] = 1 / (1 + exp_vec_##suffix(-*(const vec_##suffix*)&a[i])); \
+        } \
+        for (; i < n; i++) { \
+            out[i] = fast_sigmoid(a[i]); \
+        } \
+    } \
+    \
+    __attribute__((target(target_isa))) \
+    static void fast_tanh_##suffix(const Scalar* a, Scalar* out, int n) { \
+        int i = 0; \
+        for (; i + width_##suffix <= n; i += width_##suffix) { \
+            vec_##suffix x = *(const vec_##suffix*)&a[i]; \
+            bits_##suffix negative = x < 0; \
+            vec_##suffix e = exp_vec_##suffix(-2 * select_##suffix(negative, -x, x)); \
+            vec_##suffix t = (1 - e) / (1 + e); \
+            *(vec_##suffix*)&out[i] = select_##suffix(negative, -t, t); \
+        } \
+        for (; i < n; i++) { \
+            out[i] = fast_tanh(a[i]); \
+        } \
+    }
+
+DEFINE_SIMD_KERNELS(sse2, "sse2", 16)
+DEFINE_SIMD_KERNELS(avx2, "avx2", 32)
+DEFINE_SIMD_KERNELS(avx512, "avx512f", 64)
+
+static const SimdKernels sse2_kernels = {SIMD_SSE2, "sse2", &add_sse2, &multiply_sse2, &scale_sse2,
+    &add_scalar_sse2, &axpy_sse2, &momentum_update_sse2, &adam_update_sse2, &relu_sse2,
+    &sigmoid_backward_sse2, &tanh_backward_sse2, &relu_backward_sse2, &fast_exp_sse2, &fast_log_sse2,
+    &fast_sigmoid_sse2, &fast_tanh_sse2};
+static const SimdKernels avx2_kernels = {SIMD_AVX2, "avx2", &add_avx2, &multiply_avx2, &scale_avx2,
+    &add_scalar_avx2, &axpy_avx2, &momentum_update_avx2, &adam_update_avx2, &relu_avx2,
+    &sigmoid_backward_avx2, &tanh_backward_avx2, &relu_backward_avx2, &fast_exp_avx2, &fast_log_avx2,
+    &fast_sigmoid_avx2, &fast_tanh_avx2};
+static const SimdKernels avx512_kernels = {SIMD_AVX512, "avx512", &add_avx512, &multiply_avx512, &scale_avx512,
+    &add_scalar_avx512, &axpy_avx512, &momentum_update_avx512, &adam_update_avx512, &relu_avx512,
+    &sigmoid_backward_avx512, &tanh_backward_avx512, &relu_backward_avx512, &fast_exp_avx512, &fast_log_avx512,
+    &fast_sigmoid_avx512, &fast_tanh_avx512};
+
+static SimdLevel detect_simd_level() {
+    // Uses cpuid (through GCC's builtins) to find the most capable instruction set the CPU supports.
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return SIMD_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return SIMD_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SIMD_SSE2;
+    }
+    return SIMD_SCALAR;
+}
+
+#else
+
+static SimdLevel detect_simd_level() {
+    // Only scalar kernels are available on non-x86 platforms.
+    return SIMD_SCALAR;
+}
+
+#endif
+
+static const SimdKernels* kernels_for_level(SimdLevel level) {
+    switch (level) {
+#if defined(__x86_64__) || defined(__i386__)
+        case SIMD_AVX512:
+            return &avx512_kernels;
+
+        case SIMD_AVX2:
+            return &avx2_kernels;
+
+        case SIMD_SSE2:
+            return &sse2_kernels;
+#endif
+
+        default:
+            return &scalar_kernels;
+    }
+}
+
+static const SimdKernels* selected_kernels = &scalar_kernels;
+
+__attribute__((constructor))
+static void select_simd_kernels() {
+    // Selects the kernels once at startup. NN_SIMD_LEVEL can force a lower level than the CPU supports (e.g.
+    // to compare kernels on the same machine), but never a higher one.
+    SimdLevel supported = detect_simd_level();
+    SimdLevel level = supported;
+
+    const char* forced = getenv("NN_SIMD_LEVEL");
+    if (forced != NULL) {
+        const char* names[] = {"scalar", "sse2", "avx2", "avx512"};
+        int found = 0;
+
+        for (int i=0; i < (int)(sizeof(names) / sizeof(names[0])); i++) {
+            if (strcmp(forced, names[i]) == 0) {
+                level = (SimdLevel)i;
+                found = 1;
+            }
+        }
+
+        if (!found) {
+            printf("Unknown NN_SIMD_LEVEL \"%s\", using %s\n", forced, kernels_for_level(supported)->name);
+        }
+        else if (level > supported) {
+            printf("NN_SIMD_LEVEL \"%s\" is not supported by this CPU, using %s\n", forced,
+                kernels_for_level(supported)->name);
+            level = supported;
+        }
+    }
+
+    selected_kernels = kernels_for_level(level);
+}
+
+const SimdKernels* get_simd_kernels() {
+    return selected_kernels;
+}
\ No newline at end of file
@@ -3,14 +3,23 @@
 #include "maths/softmax.h"
 #include "maths/activation.h"
 #include "maths/matrix.h"
+#include "maths/simd.h"
+
+// Number of columns softmax_fast_func_into processes at once, which bounds the size of its per-column buffers.
+#define SOFTMAX_BLOCK_COLS 256
 
 // Softmax is a special case activation function, in that it is not element-wise. NULL attributes as the
 // softmax functions are not the correct type for the ActivationFunc attributes.
-const ActivationFunc softmax = {NULL, NULL};
+const ActivationFunc softmax = {NULL, NULL, NULL, NULL, NULL};
 
 Matrix softmax_func(const Matrix* x) {
-    Matrix result = create_matrix(x->rows, x->cols);
+    Matrix result = create_uninitialised_matrix(x->rows, x->cols, x->layout);
+    softmax_func_into(&result, x);
+
+    return result;
+}
 
+void softmax_func_into(Matrix* result, const Matrix* x) {
     // Softmax is applied to each column (sample) independently.
     for (int col_count=0; col_count < x->cols; col_count++) {
         // Finding the max value in the column
@@ -26,22 +35,120 @@ Matrix softmax_func(const Matrix* x) {
         for (int row_count=0; row_count < x->rows; row_count++) {
             double ele = get_element(x, row_count, col_count);
             double exp_ele = exp(ele - max_val);
-            set_element(&result, row_count, col_count, exp_ele);
+            set_element(result, row_count, col_count, exp_ele);
             exp_sum += exp_ele;
         }
 
         for (int row_count=0; row_count < x->rows; row_count++) {
-            double result_ele = get_element(&result, row_count, col_count);
-            set_element(&result, row_count, col_count, result_ele / exp_sum);
+            double result_ele = get_element(result, row_count, col_count);
+            set_element(result, row_count, col_count, result_ele / exp_sum);
         }
     }
+}
 
-    return result;
+static void softmax_fast_columns_into(Matrix* result, const Matrix* x) {
+    // Column-major version of softmax_fast_func_into, for which each column is contiguous. The maximum of each
+    // column is subtracted from it a column at a time, and then the whole result is exponentiated in one call if
+    // its columns directly follow each other, as they do in the network's workspace, before each column is
+    // divided by its sum.
+    const SimdKernels* kernels = get_simd_kernels();
+    for (int col_count=0; col_count < x->cols; col_count++) {
+        const Scalar* x_col = &x->data[(size_t)col_count * x->stride];
+        Scalar* result_col = &result->data[(size_t)col_count * result->stride];
+        Scalar max_val = x_col[0];
+        for (int row_count=1; row_count < x->rows; row_count++) {
+            if (x_col[row_count] > max_val) {
+                max_val = x_col[row_count];
+            }
+        }
+        for (int row_count=0; row_count < x->rows; row_count++) {
+            result_col[row_count] = x_col[row_count] - max_val;
+        }
+    }
+
+    if (result->stride == result->rows) {
+        kernels->fast_exp(result->data, result->data, result->rows * result->cols);
+    }
+    else {
+        for (int col_count=0; col_count < result->cols; col_count++) {
+            Scalar* result_col = &result->data[(size_t)col_count * result->stride];
+            kernels->fast_exp(result_col, result_col, result->rows);
+        }
+    }
+
+    for (int col_count=0; col_count < result->cols; col_count++) {
+        Scalar* result_col = &result->data[(size_t)col_count * result->stride];
+        Scalar sum = 0;
+        for (int row_count=0; row_count < result->rows; row_count++) {
+            sum += result_col[row_count];
+        }
+        Scalar inverse = 1 / sum;
+        for (int row_count=0; row_count < result->rows; row_count++) {
+            result_col[row_count] *= inverse;
+        }
+    }
+}
+
+void softmax_fast_func_into(Matrix* result, const Matrix* x) {
+    if (x->layout == MATRIX_COL_MAJOR && result->layout == MATRIX_COL_MAJOR) {
+        softmax_fast_columns_into(result, x);
+        return;
+    }
+    if (x->layout != result->layout) {
+        // Matrices of different layouts fall back to the exact version, which works an element at a time.
+        softmax_func_into(result, x);
+        return;
+    }
+
+    const SimdKernels* kernels = get_simd_kernels();
+    Scalar neg_max[SOFTMAX_BLOCK_COLS], sums[SOFTMAX_BLOCK_COLS];
+
+    for (int first_col=0; first_col < x->cols; first_col += SOFTMAX_BLOCK_COLS) {
+        int block_cols = (x->cols - first_col < SOFTMAX_BLOCK_COLS) ? x->cols - first_col : SOFTMAX_BLOCK_COLS;
+
+        // Finding the max value in each column, which is subtracted (as its negation is added) before
+        // exponentiating so that exp cannot overflow.
+        for (int col_count=0; col_count < block_cols; col_count++) {
+            neg_max[col_count] = -x->data[first_col + col_count];
+            sums[col_count] = 0;
+        }
+        for (int row_count=1; row_count < x->rows; row_count++) {
+            const Scalar* x_row = &x->data[row_count * x->stride + first_col];
+            for (int col_count=0; col_count < block_cols; col_count++) {
+                if (-x_row[col_count] < neg_max[col_count]) {
+                    neg_max[col_count] = -x_row[col_count];
+                }
+            }
+        }
+
+        for (int row_count=0; row_count < x->rows; row_count++) {
+            const Scalar* x_row = &x->data[row_count * x->stride + first_col];
+            Scalar* result_row = &result->data[row_count * result->stride + first_col];
+            kernels->add(x_row, neg_max, result_row, block_cols);
+            kernels->fast_exp(result_row, result_row, block_cols);
+            kernels->add(sums, result_row, sums, block_cols);
+        }
+
+        for (int col_count=0; col_count < block_cols; col_count++) {
+            sums[col_count] = 1 / sums[col_count];
+        }
+        for (int row_count=0; row_count < x->rows; row_count++) {
+            Scalar* result_row = &result->data[row_count * result->stride + first_col];
+            kernels->multiply(result_row, sums, result_row, block_cols);
+        }
+    }
 }
 
 Matrix softmax_derivative(const Matrix* x, const Matrix* loss_deriv) {
-    Matrix gradient_matrix = create_matrix(x->rows, x->cols);
+    Matrix gradient_matrix = create_uninitialised_matrix(x->rows, x->cols, x->layout);
+    softmax_derivative_into(&gradient_matrix, x, loss_deriv);
 
+    return gradient_matrix;
+}
+
+void softmax_derivative_into(Matrix* gradient_matrix, const Matrix* x, const Matrix* loss_deriv) {
+    // Each element of the gradient depends on a whole column of loss_deriv, so gradient_matrix must not be the
+    // same matrix as loss_deriv.
     for (int col_count=0; col_count < x->cols; col_count++) {
         for (int i=0; i < x->rows; i++) {
             double s_i = get_element(x, i, col_count);
@@ -62,9 +169,7 @@ Matrix softmax_derivative(const Matrix* x, const Matrix* loss_deriv) {
                 grad_sum += jacobian_i_j * dL_da_j;
             }
 
-            set_element(&gradient_matrix, i, col_count, grad_sum);
+            set_element(gradient_matrix, i, col_count, grad_sum);
         }
     }
-
-    return gradient_matrix;
 }
\ No newline at end of file
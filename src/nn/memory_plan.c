@@ -0,0 +1,62 @@
+#include <stdint.h>
+#include "nn/memory_plan.h"
+
+// Offset of buffers that have not been placed yet.
+#define UNPLACED SIZE_MAX
+
+static int lifetimes_overlap(const PlannedBuffer* a, const PlannedBuffer* b) {
+    return a->first_use <= b->last_use && b->first_use <= a->last_use;
+}
+
+static int largest_unplaced(const PlannedBuffer* buffers, int count) {
+    // Returns the index of the largest buffer not yet placed, or -1 if every buffer has been. Ties go to the
+    // first, so plans do not depend on anything but the order of the buffers.
+    int largest = -1;
+    for (int i=0; i < count; i++) {
+        if (buffers[i].offset == UNPLACED && (largest < 0 || buffers[i].size > buffers[largest].size)) {
+            largest = i;
+        }
+    }
+    return largest;
+}
+
+static size_t lowest_free_offset(const PlannedBuffer* buffers, int count, const PlannedBuffer* buffer) {
+    // Starting from 0, moves the candidate offset past any placed buffer that is live at the same time and
+    // overlaps it, until none does. The candidate only ever increases, so this ends, and the number of buffers
+    // is small (a few per layer), so the repeated scans cost nothing next to a training step.
+    size_t offset = 0;
+    int moved = 1;
+    while (moved) {
+        moved = 0;
+        for (int i=0; i < count; i++) {
+            const PlannedBuffer* other = &buffers[i];
+            if (other == buffer || other->offset == UNPLACED || !lifetimes_overlap(buffer, other)) {
+                continue;
+            }
+            if (offset < other->offset + other->size && other->offset < offset + buffer->size) {
+                offset = other->offset + other->size;
+                moved = 1;
+            }
+        }
+    }
+    return offset;
+}
+
+size_t plan_buffers(PlannedBuffer* buffers, int count) {
+    for (int i=0; i < count; i++) {
+        buffers[i].offset = UNPLACED;
+    }
+
+    // Placing the largest buffers first leaves the smaller ones to fill the gaps between them, which gets close
+    // to the best plan for the short, mostly nested lifetimes of a network's intermediates.
+    size_t slab_size = 0;
+    int next;
+    while ((next = largest_unplaced(buffers, count)) >= 0) {
+        PlannedBuffer* buffer = &buffers[next];
+        buffer->offset = lowest_free_offset(buffers, count, buffer);
+        if (buffer->offset + buffer->size > slab_size) {
+            slab_size = buffer->offset + buffer->size;
+        }
+    }
+    return slab_size;
+}
\ No newline at end of file
@@ -1,6 +1,11 @@
+#include <stdio.h>
 #include <stdlib.h>
+#include <sys/mman.h>
 #include "nn/neural_network.h"
+#include "nn/telemetry.h"
+#include "nn/memory_plan.h"
 #include "maths/matrix.h"
+#include "maths/aligned_buffer.h"
 #include "maths/activation.h"
 #include "maths/softmax.h"
 
@@ -14,15 +19,23 @@ static Layer init_layer(int input_size, int output_size, const ActivationFunc* a
     weight_init_fn(&new_layer.weights);
     new_layer.biases = create_matrix(output_size, 1);
     new_layer.activation = activation;
+    new_layer.weight_init = weight_init_fn;
     new_layer.num_nodes = output_size;
 
-    // Filling with empty matrices so no errors if they are freed before a forward pass is performed.
+    // Filling with empty matrices until the network's workspace is allocated.
     new_layer.z = empty_matrix();
     new_layer.a = empty_matrix();
+    new_layer.dL_da = empty_matrix();
     new_layer.dL_dz = empty_matrix();
     new_layer.dL_dw = empty_matrix();
     new_layer.dL_db = empty_matrix();
 
+    // Optimizer state is only allocated for training.
+    new_layer.weights_moment1 = empty_matrix();
+    new_layer.weights_moment2 = empty_matrix();
+    new_layer.biases_moment1 = empty_matrix();
+    new_layer.biases_moment2 = empty_matrix();
+
     return new_layer;
 }
 
@@ -32,6 +45,16 @@ Network init_neural_net(int num_layers, int input_nodes, int layer_sizes[], cons
     Network new_network;
     new_network.num_layers = num_layers;
     new_network.layers = calloc(num_layers, sizeof(Layer));
+    new_network.workspace.buffer = NULL;
+    new_network.workspace.bytes = 0;
+    new_network.workspace.unplanned_bytes = 0;
+    new_network.workspace.max_batch = 0;
+    new_network.workspace.plan = NULL;
+    new_network.workspace.lean = 0;
+    new_network.workspace.checkpoint_interval = 0;
+    new_network.math_accuracy = MATH_EXACT;
+    new_network.checkpoint_mapping = NULL;
+    new_network.checkpoint_mapping_bytes = 0;
 
     for (int i=0; i < num_layers; i++) {
         int input_size = (i==0) ? input_nodes : new_network.layers[i-1].num_nodes;
@@ -42,15 +65,32 @@ Network init_neural_net(int num_layers, int input_nodes, int layer_sizes[], cons
     return new_network;
 }
 
+static void free_workspace(Workspace* workspace) {
+    free_aligned(workspace->buffer);
+    free(workspace->plan);
+    workspace->buffer = NULL;
+    workspace->plan = NULL;
+    workspace->bytes = 0;
+    workspace->unplanned_bytes = 0;
+    workspace->max_batch = 0;
+}
+
 static void free_layer(Layer* layer) {
     // Freeing memory allocated to storing matrices in Layer struct
     free_matrix(&layer->weights);
     free_matrix(&layer->biases);
-    free_matrix(&layer->z);
-    free_matrix(&layer->a);
-    free_matrix(&layer->dL_dz);
-    free_matrix(&layer->dL_dw);
-    free_matrix(&layer->dL_db);
+    free_matrix(&layer->weights_moment1);
+    free_matrix(&layer->weights_moment2);
+    free_matrix(&layer->biases_moment1);
+    free_matrix(&layer->biases_moment2);
+
+    // The remaining matrices are views into the network's workspace, which is freed separately.
+    layer->z = empty_matrix();
+    layer->a = empty_matrix();
+    layer->dL_da = empty_matrix();
+    layer->dL_dz = empty_matrix();
+    layer->dL_dw = empty_matrix();
+    layer->dL_db = empty_matrix();
 
     layer->num_nodes = 0;
 }
@@ -66,38 +106,445 @@ void free_network(Network* net) {
         net->layers = NULL;
     }
 
+    free_workspace(&net->workspace);
+
+    // Weights and biases loaded from a mapped checkpoint are views, so the mapping is released here instead.
+    if (net->checkpoint_mapping != NULL) {
+        munmap(net->checkpoint_mapping, net->checkpoint_mapping_bytes);
+        net->checkpoint_mapping = NULL;
+        net->checkpoint_mapping_bytes = 0;
+    }
+
     net->num_layers = 0;
 }
 
+Network create_replica(const Network* net) {
+    // Creates a network that shares the weights and biases of an existing network, but has its own workspace.
+    Network replica;
+    replica.num_layers = net->num_layers;
+    replica.layers = calloc(net->num_layers, sizeof(Layer));
+    replica.workspace.buffer = NULL;
+    replica.workspace.bytes = 0;
+    replica.workspace.unplanned_bytes = 0;
+    replica.workspace.max_batch = 0;
+    replica.workspace.plan = NULL;
+    replica.workspace.lean = net->workspace.lean; // Replicas store their intermediates in the same way
+    replica.workspace.checkpoint_interval = net->workspace.checkpoint_interval;
+    replica.math_accuracy = net->math_accuracy;
+    replica.checkpoint_mapping = NULL; // Any mapping stays owned by the original network
+    replica.checkpoint_mapping_bytes = 0;
+
+    for (int i=0; i < net->num_layers; i++) {
+        // Copying the Layer struct copies the weight and bias matrices' data pointers, not their data.
+        replica.layers[i] = net->layers[i];
+        replica.layers[i].z = empty_matrix();
+        replica.layers[i].a = empty_matrix();
+        replica.layers[i].dL_da = empty_matrix();
+        replica.layers[i].dL_dz = empty_matrix();
+        replica.layers[i].dL_dw = empty_matrix();
+        replica.layers[i].dL_db = empty_matrix();
+
+        // Only the original network's parameters are updated, so replicas have no optimizer state.
+        replica.layers[i].weights_moment1 = empty_matrix();
+        replica.layers[i].weights_moment2 = empty_matrix();
+        replica.layers[i].biases_moment1 = empty_matrix();
+        replica.layers[i].biases_moment2 = empty_matrix();
+    }
+
+    return replica;
+}
+
+void free_replica(Network* replica) {
+    // Frees a replica's workspace and layers, without freeing the weights and biases it shares.
+    free(replica->layers);
+    replica->layers = NULL;
+    replica->num_layers = 0;
+
+    free_workspace(&replica->workspace);
+}
+
+static size_t padded_size(size_t count) {
+    // Rounds a number of elements up to a whole number of 64-byte cache lines, so that every matrix in the
+    // workspace starts on a cache line boundary.
+    size_t per_line = 64 / sizeof(Scalar);
+    return ((count + per_line - 1) / per_line) * per_line;
+}
+
+// Number of intermediate matrices each layer has in the workspace: z, a, dL_da, dL_dz, dL_dw, dL_db, and the
+// space its output is recomputed into when activations are checkpointed.
+#define WORKSPACE_MATRICES_PER_LAYER 7
+
+static PlannedBuffer planned_buffer(size_t size, int first_use, int last_use) {
+    PlannedBuffer buffer = {size, first_use, last_use, 0};
+    return buffer;
+}
+
+static int is_elementwise(const Layer* layer) {
+    return layer->activation != &softmax;
+}
+
+static int output_kept(const Network* net, int layer_index) {
+    // Whether a layer's output is kept from the forward pass until backpropagation, rather than recomputed.
+    // With checkpointing, only every checkpoint_interval-th layer's output is kept, along with the output
+    // layer's and those of softmax layers, which are never recomputed.
+    int interval = net->workspace.checkpoint_interval;
+    return interval <= 1 || layer_index == net->num_layers - 1 || (layer_index + 1) % interval == 0 ||
+        !is_elementwise(&net->layers[layer_index]);
+}
+
+static int recomputes_inputs(const Network* net, int layer_index) {
+    // Whether backpropagation through a layer starts by recomputing the outputs of the layers below it, back
+    // to the last kept output, as its input was not kept.
+    return output_kept(net, layer_index) && layer_index > 0 && !output_kept(net, layer_index - 1);
+}
+
+static void plan_layer_buffers(const Network* net, int layer_index, const int* backward_steps,
+    const int* recompute_steps, int max_batch, PlannedBuffer* buffers) {
+    // Fills in the size and lifetime of each of a layer's workspace matrices, in the order above, where
+    // lifetimes are in the steps of a training step: the forward pass of layer i is step i, the loss is step L
+    // (for L layers), then comes backpropagation through each layer, preceded by recomputing the outputs of the
+    // layers below it if they were not kept, and finally the optimizer's update.
+    const Layer* layer = &net->layers[layer_index];
+    int num_layers = net->num_layers;
+    int lean = net->workspace.lean;
+    int forward = layer_index;
+    int loss = num_layers;
+    int backward = backward_steps[layer_index];
+    int update = backward_steps[0] + 1;
+    int output_layer = (layer_index == num_layers - 1);
+    size_t batch_matrix = padded_size((size_t)layer->num_nodes * max_batch);
+
+    // z is only read by softmax, within the layer's own forward step, as backpropagation works from a. In lean
+    // mode, element-wise activations are applied in place, so z is the same matrix as a.
+    size_t z_size = (lean && is_elementwise(layer)) ? 0 : batch_matrix;
+    buffers[0] = planned_buffer(z_size, forward, forward);
+    // a is the next layer's input, and is read again by backpropagation through both layers, unless it is
+    // recomputed for them.
+    int kept = output_kept(net, layer_index);
+    buffers[1] = planned_buffer(batch_matrix, forward, kept ? backward : forward + 1);
+    buffers[6] = planned_buffer(kept ? 0 : batch_matrix, kept ? 0 : recompute_steps[layer_index], backward);
+    // The output layer's dL_da and dL_dz come from the loss, and every other layer's from backpropagation.
+    // dL_dz is also read by the step propagating it to the previous layer. In lean mode, the derivative of an
+    // element-wise activation overwrites dL_da, so dL_dz is the same matrix as dL_da.
+    int first_derivative = output_layer ? loss : backward;
+    int last_derivative = (layer_index > 0) ? backward_steps[layer_index - 1] : backward;
+    size_t dL_da_size = (lean && is_elementwise(layer)) ? 0 : batch_matrix;
+    buffers[2] = planned_buffer(dL_da_size, first_derivative, first_derivative);
+    buffers[3] = planned_buffer(batch_matrix, first_derivative, last_derivative);
+    // The gradients are read by the optimizer (and, with multiple threads, summed across workers) at the end.
+    buffers[4] = planned_buffer(padded_size((size_t)layer->weights.rows * layer->weights.cols), backward,
+        update);
+    buffers[5] = planned_buffer(padded_size(layer->num_nodes), backward, update);
+}
+
+static PlannedBuffer* plan_workspace(const Network* net, int max_batch, size_t* planned_size,
+    size_t* unplanned_size) {
+    // Plans the workspace of the network for batches of up to max_batch samples, returning each layer's buffers
+    // in turn (to be freed by the caller), or NULL if allocation failed. Sizes are in elements.
+    int num_layers = net->num_layers;
+    int count = WORKSPACE_MATRICES_PER_LAYER * num_layers;
+    PlannedBuffer* buffers = malloc(count * sizeof(PlannedBuffer));
+    int* steps = malloc(2 * num_layers * sizeof(int));
+    if (buffers == NULL || steps == NULL) {
+        free(buffers);
+        free(steps);
+        return NULL;
+    }
+
+    // Numbering the steps of backpropagation, which runs from the output layer down, with each recomputation
+    // of a run of outputs that were not kept as a step of its own, before the layer that needs them.
+    int* backward_steps = steps;
+    int* recompute_steps = steps + num_layers;
+    int step = num_layers + 1;
+    for (int i=num_layers-1; i >= 0; i--) {
+        if (recomputes_inputs(net, i)) {
+            for (int j=i-1; j >= 0 && !output_kept(net, j); j--) {
+                recompute_steps[j] = step;
+            }
+            step++;
+        }
+        backward_steps[i] = step++;
+    }
+
+    *unplanned_size = 0;
+    for (int i=0; i < num_layers; i++) {
+        PlannedBuffer* layer_buffers = &buffers[WORKSPACE_MATRICES_PER_LAYER * i];
+        plan_layer_buffers(net, i, backward_steps, recompute_steps, max_batch, layer_buffers);
+        for (int j=0; j < WORKSPACE_MATRICES_PER_LAYER; j++) {
+            *unplanned_size += layer_buffers[j].size;
+        }
+    }
+    *planned_size = plan_buffers(buffers, count);
+
+    free(steps);
+    return buffers;
+}
+
+size_t planned_workspace_bytes(const Network* net, int max_batch) {
+    size_t planned_size, unplanned_size;
+    PlannedBuffer* buffers = plan_workspace(net, max_batch, &planned_size, &unplanned_size);
+    if (buffers == NULL) {
+        printf("Memory allocation failed\n");
+        return 0;
+    }
+    free(buffers);
+    return planned_size * sizeof(Scalar);
+}
+
+void set_workspace_memory(Network* net, int lean, int checkpoint_interval) {
+    if (checkpoint_interval < 0) {
+        checkpoint_interval = 0;
+    }
+    if (lean == net->workspace.lean && checkpoint_interval == net->workspace.checkpoint_interval) {
+        return;
+    }
+
+    // The workspace is planned afresh for the new mode when it is next reserved, for the same batch size.
+    int max_batch = net->workspace.max_batch;
+    free_workspace(&net->workspace);
+    net->workspace.lean = lean;
+    net->workspace.checkpoint_interval = checkpoint_interval;
+    if (max_batch > 0) {
+        reserve_workspace(net, max_batch);
+    }
+}
+
+int reserve_workspace(Network* net, int max_batch) {
+    if (net->workspace.buffer != NULL && max_batch <= net->workspace.max_batch) {
+        return 1;
+    }
+
+    size_t total_size, unplanned_size;
+    PlannedBuffer* plan = plan_workspace(net, max_batch, &total_size, &unplanned_size);
+    Scalar* buffer = (plan != NULL) ? alloc_aligned(total_size * sizeof(Scalar)) : NULL;
+    if (buffer == NULL) {
+        printf("Memory allocation failed\n");
+        free(plan);
+        return 0;
+    }
+
+    free_aligned(net->workspace.buffer);
+    free(net->workspace.plan);
+    net->workspace.buffer = buffer;
+    net->workspace.plan = plan;
+    net->workspace.bytes = total_size * sizeof(Scalar);
+    net->workspace.unplanned_bytes = unplanned_size * sizeof(Scalar);
+    net->workspace.max_batch = max_batch;
+
+    // Carving the buffer into each layer's matrices at their planned offsets, with matrices that were given no
+    // space sharing that of the matrix they are computed in place in. Batch-sized matrices are given 0 columns
+    // until a forward pass sets the batch size.
+    for (int i=0; i < net->num_layers; i++) {
+        Layer* layer = &net->layers[i];
+        const PlannedBuffer* layer_plan = &plan[WORKSPACE_MATRICES_PER_LAYER * i];
+        Scalar* a = buffer + layer_plan[1].offset;
+        Scalar* dL_dz = buffer + layer_plan[3].offset;
+
+        layer->z = matrix_view((layer_plan[0].size > 0) ? buffer + layer_plan[0].offset : a, layer->num_nodes, 0);
+        layer->a = matrix_view(a, layer->num_nodes, 0);
+        layer->dL_da = matrix_view((layer_plan[2].size > 0) ? buffer + layer_plan[2].offset : dL_dz,
+            layer->num_nodes, 0);
+        layer->dL_dz = matrix_view(dL_dz, layer->num_nodes, 0);
+        layer->dL_dw = matrix_view(buffer + layer_plan[4].offset, layer->weights.rows, layer->weights.cols);
+        layer->dL_db = matrix_view(buffer + layer_plan[5].offset, layer->num_nodes, 1);
+    }
+
+    return 1;
+}
+
+static void set_batch_size(Network* net, int batch_size, MatrixLayout layout) {
+    // Gives every batch-sized matrix in the workspace one column per sample, and the layout of the batch. Each is
+    // a contiguous prefix of its region of the workspace. Outputs are pointed back at the space they are
+    // written to by the forward pass, in case backpropagation last recomputed them elsewhere.
+    for (int i=0; i < net->num_layers; i++) {
+        Layer* layer = &net->layers[i];
+        layer->a.data = net->workspace.buffer + net->workspace.plan[WORKSPACE_MATRICES_PER_LAYER * i + 1].offset;
+        Matrix* batch_matrices[] = {&layer->z, &layer->a, &layer->dL_da, &layer->dL_dz};
+
+        for (int j=0; j < 4; j++) {
+            *batch_matrices[j] = matrix_view_with_layout(batch_matrices[j]->data, layer->num_nodes, batch_size,
+                layout);
+        }
+    }
+}
+
+size_t workspace_bytes(const Network* net) {
+    return net->workspace.bytes;
+}
+
+size_t unplanned_workspace_bytes(const Network* net) {
+    return net->workspace.unplanned_bytes;
+}
+
 Matrix forward_pass(Network* net, const Matrix* input) {
-    Matrix layer_in, temp, layer_out;
-    layer_in = copy_matrix(input);
+    return copy_matrix(forward_pass_into_layers(net, input));
+}
+
+const Matrix* forward_pass_into_layers(Network* net, const Matrix* input) {
+    return forward_pass_timed(net, input, NULL);
+}
+
+static ActivationKernel activation_kernel(const Network* net, const Layer* layer) {
+    // Returns the kernel applying an element-wise layer's activation with the network's accuracy.
+    return (net->math_accuracy == MATH_FAST) ? layer->activation->fast_apply_ptr : layer->activation->apply_ptr;
+}
+
+static void apply_softmax(const Network* net, Matrix* result, const Matrix* z) {
+    if (net->math_accuracy == MATH_FAST) {
+        softmax_fast_func_into(result, z);
+    }
+    else {
+        softmax_func_into(result, z);
+    }
+}
+
+static void forward_layer(const Network* net, Layer* layer, const Matrix* layer_in, int in_place) {
+    // Layer outputs are written in place into the workspace. The pre-activation output, z, of each layer is
+    // calculated as z = wx + b, where x is the input matrix, w is the weight matrix of the layer, and b is the
+    // bias matrix of the layer. Element-wise activations are applied in the same pass, to each block of z while
+    // it is still in cache, so z and a are each written to memory once, or if in_place is set, only a is
+    // written, with the activation applied over z where it lies.
+    if (layer->activation == &softmax) {
+        // Softmax needs a whole column of z, so is applied afterwards.
+        matrix_multiplication_bias_func_into(&layer->z, NULL, &layer->weights, layer_in, &layer->biases, NULL);
+        apply_softmax(net, &layer->a, &layer->z);
+    }
+    else {
+        Matrix* z = in_place ? &layer->a : &layer->z;
+        matrix_multiplication_bias_func_into(z, &layer->a, &layer->weights, layer_in, &layer->biases,
+            activation_kernel(net, layer));
+    }
+}
+
+const Matrix* forward_pass_timed(Network* net, const Matrix* input, double* layer_seconds) {
+    // Layers are only timed if layer_seconds is given.
+    const Matrix* layer_in = input;
+
+    if (!reserve_workspace(net, input->cols)) {
+        return &net->layers[net->num_layers-1].a;
+    }
+    set_batch_size(net, input->cols, input->layout);
 
     // Simple feedforward process: each layer's output is calculated, and given to the next layer as 
     // input until the output layer is reached. 
     for (int i=0; i < net->num_layers; i++) {
-        // The pre-activation output, z, of each layer is calculated as z = wx + b, where x is the input
-        // matrix, w is the weight matrix of the layer, and b is the bias matrix of the layer.
-        free_matrix(&net->layers[i].z);
-        free_matrix(&net->layers[i].a);
-        temp = matrix_multiplication(&net->layers[i].weights, &layer_in);
-        layer_out = matrix_broadcast_addition(&temp, &net->layers[i].biases);
-        net->layers[i].z = copy_matrix(&layer_out);
-        free_matrix(&temp);
-
-        if (net->layers[i].activation == &softmax) {
-            free_matrix(&layer_out);
-            layer_out = softmax_func(&net->layers[i].z);
+        Layer* layer = &net->layers[i];
+        double layer_start = (layer_seconds != NULL) ? wall_time_seconds() : 0.0;
+
+        forward_layer(net, layer, layer_in, net->workspace.lean);
+
+        if (layer_seconds != NULL) {
+            layer_seconds[i] += wall_time_seconds() - layer_start;
         }
-        else {
-            apply_func(&layer_out, net->layers[i].activation->func_ptr);
+        layer_in = &layer->a;
+    }
+
+    return layer_in;
+}
+
+void recompute_layer_inputs(Network* net, const Matrix* input, int layer_index) {
+    if (!recomputes_inputs(net, layer_index)) {
+        return;
+    }
+
+    // Finding the last layer below whose output was kept, and running the forward pass again from there up to
+    // this layer's input, with each output pointed at the space planned for its recomputation.
+    int first = layer_index - 1;
+    while (first > 0 && !output_kept(net, first - 1)) {
+        first--;
+    }
+    const Matrix* layer_in = (first > 0) ? &net->layers[first-1].a : input;
+    for (int i=first; i < layer_index; i++) {
+        Layer* layer = &net->layers[i];
+        Scalar* recomputed = net->workspace.buffer + net->workspace.plan[WORKSPACE_MATRICES_PER_LAYER * i + 6].offset;
+        layer->a = matrix_view_with_layout(recomputed, layer->a.rows, layer->a.cols, layer->a.layout);
+        forward_layer(net, layer, layer_in, 1);
+        layer_in = &layer->a;
+    }
+}
+
+static int widest_layer(const Network* net) {
+    int widest = 0;
+    for (int i=0; i < net->num_layers; i++) {
+        if (net->layers[i].num_nodes > widest) {
+            widest = net->layers[i].num_nodes;
         }
+    }
+    return widest;
+}
 
-        net->layers[i].a = copy_matrix(&layer_out);
+int reserve_inference_scratch(InferenceScratch* scratch, const Network* net, int max_batch) {
+    if (scratch->buffer != NULL && max_batch <= scratch->max_batch) {
+        return 1;
+    }
 
-        free_matrix(&layer_in);
-        layer_in = layer_out;
+    size_t half_size = padded_size((size_t)widest_layer(net) * max_batch);
+    Scalar* buffer = alloc_aligned(2 * half_size * sizeof(Scalar));
+    if (buffer == NULL) {
+        printf("Memory allocation failed\n");
+        return 0;
+    }
+
+    free_aligned(scratch->buffer);
+    scratch->buffer = buffer;
+    scratch->bytes = 2 * half_size * sizeof(Scalar);
+    scratch->max_batch = max_batch;
+    return 1;
+}
+
+void free_inference_scratch(InferenceScratch* scratch) {
+    free_aligned(scratch->buffer);
+    scratch->buffer = NULL;
+    scratch->bytes = 0;
+    scratch->max_batch = 0;
+}
+
+Matrix predict(const Network* net, const Matrix* input) {
+    Matrix output = create_uninitialised_matrix(net->layers[net->num_layers-1].num_nodes, input->cols,
+        input->layout);
+    InferenceScratch scratch = {NULL, 0, 0};
+
+    predict_into(&output, net, input, &scratch);
+
+    free_inference_scratch(&scratch);
+    return output;
+}
+
+void predict_into(Matrix* output, const Network* net, const Matrix* input, InferenceScratch* scratch) {
+    const Layer* output_layer = &net->layers[net->num_layers-1];
+    if (output->rows != output_layer->num_nodes || output->cols != input->cols) {
+        printf("Incompatible dimensions for prediction output.\n");
+        return;
     }
+    if (!reserve_inference_scratch(scratch, net, input->cols)) {
+        return;
+    }
+
+    Scalar* halves[2] = {scratch->buffer, scratch->buffer + scratch->bytes / (2 * sizeof(Scalar))};
+    Matrix hidden[2];
+    const Matrix* layer_in = input;
+
+    for (int i=0; i < net->num_layers; i++) {
+        const Layer* layer = &net->layers[i];
 
-    return layer_out;
+        // Hidden layers alternate between the two halves of the scratch, and the output layer writes straight
+        // into the result. Each layer's activation overwrites its pre-activation output in place, as only the
+        // activation is needed by the next layer.
+        Matrix* layer_out = output;
+        if (i < net->num_layers-1) {
+            hidden[i % 2] = matrix_view_with_layout(halves[i % 2], layer->num_nodes, input->cols, input->layout);
+            layer_out = &hidden[i % 2];
+        }
+
+        if (layer->activation == &softmax) {
+            matrix_multiplication_bias_func_into(layer_out, NULL, &layer->weights, layer_in, &layer->biases, NULL);
+            apply_softmax(net, layer_out, layer_out);
+        }
+        else {
+            matrix_multiplication_bias_func_into(layer_out, layer_out, &layer->weights, layer_in, &layer->biases,
+                activation_kernel(net, layer));
+        }
+
+        layer_in = layer_out;
+    }
 }
\ No newline at end of file
@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "nn/optimizer.h"
+#include "nn/neural_network.h"
+#include "nn/telemetry.h"
+#include "maths/matrix.h"
+#include "maths/simd.h"
+
+static int num_moments(const Optimizer* optimizer) {
+    // Number of state matrices kept for each parameter matrix.
+    switch (optimizer->type) {
+        case MOMENTUM:
+        case NESTEROV:
+            return 1;
+
+        case ADAM:
+            return 2;
+
+        default: // SGD keeps no state
+            return 0;
+    }
+}
+
+static int init_moment(Matrix* moment, const Matrix* params, int used) {
+    // Allocates a zeroed moment matrix with the dimensions of the parameters, or zeroes an existing one. Unused
+    // moments are freed. Returns 0 if the allocation failed, and 1 otherwise.
+    if (!used) {
+        free_matrix(moment);
+        return 1;
+    }
+    if (moment->data != NULL && moment->rows == params->rows && moment->cols == params->cols) {
+        memset(moment->data, 0, matrix_storage_bytes(moment));
+        return 1;
+    }
+
+    free_matrix(moment);
+    *moment = create_matrix(params->rows, params->cols);
+    return moment->data != NULL;
+}
+
+int init_optimizer_state(Network* net, const Optimizer* optimizer) {
+    int moments = num_moments(optimizer);
+
+    for (int i=0; i < net->num_layers; i++) {
+        Layer* layer = &net->layers[i];
+        if (!init_moment(&layer->weights_moment1, &layer->weights, moments >= 1) ||
+            !init_moment(&layer->weights_moment2, &layer->weights, moments >= 2) ||
+            !init_moment(&layer->biases_moment1, &layer->biases, moments >= 1) ||
+            !init_moment(&layer->biases_moment2, &layer->biases, moments >= 2)) {
+            printf("Memory allocation failed\n");
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static int is_dense(const Matrix* matrix) {
+    // Whether a row-major matrix's rows directly follow each other, without padding. Unused moments count as
+    // dense.
+    return matrix->data == NULL || matrix->stride == matrix->cols || matrix->rows <= 1;
+}
+
+static void update_parameters(Matrix* params, const Matrix* grads, Matrix* moment1, Matrix* moment2,
+    const Optimizer* optimizer, double learning_rate, double bias_correction1, double bias_correction2) {
+    // Updates one parameter matrix. The parameters and optimizer state have rows padded to whole cache lines,
+    // while the gradients in the workspace do not, so each row is updated by its own call to the kernel, unless
+    // none of them are padded, in which case the whole matrix is updated by one call.
+    const SimdKernels* kernels = get_simd_kernels();
+    int num_rows = params->rows;
+    int n = params->cols;
+    if (is_dense(params) && is_dense(grads) && is_dense(moment1) && is_dense(moment2)) {
+        num_rows = 1;
+        n = params->rows * params->cols;
+    }
+
+    // The bias corrections of both of Adam's moments are folded into the step size and epsilon, so the kernel
+    // does not need to divide each moment by them.
+    double step_size = learning_rate, epsilon = 0.0;
+    if (optimizer->type == ADAM) {
+        step_size = learning_rate * sqrt(bias_correction2) / bias_correction1;
+        epsilon = optimizer->param.adam.epsilon * sqrt(bias_correction2);
+    }
+
+    for (int row_count=0; row_count < num_rows; row_count++) {
+        Scalar* param_row = &params->data[(size_t)row_count * params->stride];
+        const Scalar* grad_row = &grads->data[(size_t)row_count * grads->stride];
+        Scalar* moment1_row = (moment1->data != NULL) ? &moment1->data[(size_t)row_count * moment1->stride] : NULL;
+        Scalar* moment2_row = (moment2->data != NULL) ? &moment2->data[(size_t)row_count * moment2->stride] : NULL;
+
+        switch (optimizer->type) {
+            case MOMENTUM:
+            case NESTEROV:
+                kernels->momentum_update(param_row, grad_row, moment1_row, learning_rate,
+                    optimizer->param.momentum.momentum, optimizer->type == NESTEROV, n);
+                break;
+
+            case ADAM:
+                kernels->adam_update(param_row, grad_row, moment1_row, moment2_row, optimizer->param.adam.beta1,
+                    optimizer->param.adam.beta2, step_size, epsilon, n);
+                break;
+
+            default: // SGD
+                kernels->axpy(-learning_rate, grad_row, param_row, n);
+                break;
+        }
+    }
+}
+
+void optimizer_step(Network* net, const Optimizer* optimizer, double learning_rate, int step) {
+    optimizer_step_timed(net, optimizer, learning_rate, step, NULL);
+}
+
+void optimizer_step_timed(Network* net, const Optimizer* optimizer, double learning_rate, int step,
+    double* layer_seconds) {
+    // Adam's moment estimates start at zero, so are biased towards it by factors of 1 - beta^step.
+    double bias_correction1 = 1.0, bias_correction2 = 1.0;
+    if (optimizer->type == ADAM) {
+        bias_correction1 = 1.0 - pow(optimizer->param.adam.beta1, step);
+        bias_correction2 = 1.0 - pow(optimizer->param.adam.beta2, step);
+    }
+
+    for (int layer_count=0; layer_count < net->num_layers; layer_count++) {
+        Layer* curr_layer = &net->layers[layer_count];
+        double layer_start = (layer_seconds != NULL) ? wall_time_seconds() : 0.0;
+
+        update_parameters(&curr_layer->weights, &curr_layer->dL_dw, &curr_layer->weights_moment1,
+            &curr_layer->weights_moment2, optimizer, learning_rate, bias_correction1, bias_correction2);
+        update_parameters(&curr_layer->biases, &curr_layer->dL_db, &curr_layer->biases_moment1,
+            &curr_layer->biases_moment2, optimizer, learning_rate, bias_correction1, bias_correction2);
+
+        if (layer_seconds != NULL) {
+            layer_seconds[layer_count] += wall_time_seconds() - layer_start;
+        }
+    }
+}
+
+size_t optimizer_state_bytes(const Network* net) {
+    size_t bytes = 0;
+    for (int i=0; i < net->num_layers; i++) {
+        const Layer* layer = &net->layers[i];
+        const Matrix* moments[] = {&layer->weights_moment1, &layer->weights_moment2, &layer->biases_moment1,
+            &layer->biases_moment2};
+
+        for (int j=0; j < 4; j++) {
+            if (moments[j]->data != NULL) {
+                bytes += matrix_storage_bytes(moments[j]);
+            }
+        }
+    }
+    return bytes;
+}
\ No newline at end of file
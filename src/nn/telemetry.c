@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <time.h>
+#include "nn/telemetry.h"
+
+double wall_time_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void write_csv_header(FILE* file, const EpochStats* stats) {
+    fprintf(file, "epoch,num_epoch,steps,samples,wall_seconds,forward_seconds,backward_seconds,"
+        "optimizer_seconds,loss_seconds,samples_per_second,loss,bytes_allocated,buffer_allocations,system_allocations");
+    if (stats->layers != NULL) {
+        for (int i=0; i < stats->num_layers; i++) {
+            fprintf(file, ",layer%d_forward_seconds,layer%d_backward_seconds,layer%d_optimizer_seconds", i, i, i);
+        }
+    }
+    fprintf(file, "\n");
+}
+
+static void write_csv_line(FILE* file, const EpochStats* stats) {
+    fprintf(file, "%d,%d,%d,%ld,%.6f,%.6f,%.6f,%.6f,%.6f,%.1f,%.9g,%zu,%zu,%zu", stats->epoch, stats->num_epoch,
+        stats->steps, stats->samples, stats->wall_seconds, stats->forward_seconds, stats->backward_seconds,
+        stats->optimizer_seconds, stats->loss_seconds, stats->samples_per_second, stats->loss,
+        stats->bytes_allocated, stats->buffer_allocations, stats->system_allocations);
+
+    if (stats->layers != NULL) {
+        for (int i=0; i < stats->num_layers; i++) {
+            fprintf(file, ",%.6f,%.6f,%.6f", stats->layers[i].forward_seconds, stats->layers[i].backward_seconds,
+                stats->layers[i].optimizer_seconds);
+        }
+    }
+    fprintf(file, "\n");
+}
+
+static void write_json_line(FILE* file, const EpochStats* stats) {
+    fprintf(file, "{\"epoch\": %d, \"num_epoch\": %d, \"steps\": %d, \"samples\": %ld, \"wall_seconds\": %.6f, "
+        "\"forward_seconds\": %.6f, \"backward_seconds\": %.6f, \"optimizer_seconds\": %.6f, "
+        "\"loss_seconds\": %.6f, \"samples_per_second\": %.1f, \"loss\": %.9g, \"bytes_allocated\": %zu, "
+        "\"buffer_allocations\": %zu, \"system_allocations\": %zu",
+        stats->epoch, stats->num_epoch, stats->steps, stats->samples, stats->wall_seconds, stats->forward_seconds,
+        stats->backward_seconds, stats->optimizer_seconds, stats->loss_seconds, stats->samples_per_second,
+        stats->loss, stats->bytes_allocated, stats->buffer_allocations, stats->system_allocations);
+
+    if (stats->layers != NULL) {
+        fprintf(file, ", \"layers\": [");
+        for (int i=0; i < stats->num_layers; i++) {
+            fprintf(file, "%s{\"forward_seconds\": %.6f, \"backward_seconds\": %.6f, \"optimizer_seconds\": %.6f}",
+                (i > 0) ? ", " : "", stats->layers[i].forward_seconds, stats->layers[i].backward_seconds,
+                stats->layers[i].optimizer_seconds);
+        }
+        fprintf(file, "]");
+    }
+    fprintf(file, "}\n");
+}
+
+void write_epoch_stats(FILE* file, TelemetryFormat format, const EpochStats* stats) {
+    if (format == TELEMETRY_CSV) {
+        if (stats->epoch == 1) {
+            write_csv_header(file, stats);
+        }
+        write_csv_line(file, stats);
+    }
+    else {
+        write_json_line(file, stats);
+    }
+    fflush(file); // So that the log can be followed while training is still running
+}
\ No newline at end of file
@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "nn/thread_pool.h"
+
+typedef struct WorkerInfo {
+    ThreadPool* pool;
+    int index;
+} WorkerInfo;
+
+struct ThreadPool {
+    int num_threads;
+    pthread_t* threads;
+    WorkerInfo* workers;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+
+    // The current task. Each new task increments the generation, which is how sleeping workers tell a new
+    // task apart from the one they have already run.
+    ThreadPoolTask task;
+    void* arg;
+    unsigned long generation;
+    int remaining; // Number of started threads yet to finish the current task
+    int shutting_down;
+};
+
+static void* worker_loop(void* info_ptr) {
+    WorkerInfo* info = info_ptr;
+    ThreadPool* pool = info->pool;
+    unsigned long last_generation = 0;
+
+    pthread_mutex_lock(&pool->mutex);
+    while (1) {
+        while (pool->generation == last_generation && !pool->shutting_down) {
+            pthread_cond_wait(&pool->work_ready, &pool->mutex);
+        }
+        if (pool->shutting_down) {
+            break;
+        }
+
+        last_generation = pool->generation;
+        ThreadPoolTask task = pool->task;
+        void* arg = pool->arg;
+
+        pthread_mutex_unlock(&pool->mutex);
+        task(arg, info->index);
+        pthread_mutex_lock(&pool->mutex);
+
+        pool->remaining--;
+        if (pool->remaining == 0) {
+            pthread_cond_signal(&pool->work_done);
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+ThreadPool* create_thread_pool(int num_threads) {
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+
+    ThreadPool* pool = calloc(1, sizeof(ThreadPool));
+    if (pool == NULL) {
+        printf("Memory allocation failed\n");
+        return NULL;
+    }
+
+    pool->num_threads = num_threads;
+    pool->threads = calloc(num_threads, sizeof(pthread_t));
+    pool->workers = calloc(num_threads, sizeof(WorkerInfo));
+    if (pool->threads == NULL || pool->workers == NULL) {
+        printf("Memory allocation failed\n");
+        free(pool->threads);
+        free(pool->workers);
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+
+    // Worker 0 is the thread that runs tasks on the pool, so only the other workers need threads.
+    for (int i=1; i < num_threads; i++) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+
+        if (pthread_create(&pool->threads[i], NULL, &worker_loop, &pool->workers[i]) != 0) {
+            printf("Failed to start worker thread, using %d threads\n", i);
+            pool->num_threads = i;
+            break;
+        }
+    }
+
+    return pool;
+}
+
+void run_on_thread_pool(ThreadPool* pool, ThreadPoolTask task, void* arg) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->task = task;
+    pool->arg = arg;
+    pool->remaining = pool->num_threads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->mutex);
+
+    task(arg, 0);
+
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->remaining > 0) {
+        pthread_cond_wait(&pool->work_done, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+int thread_pool_size(const ThreadPool* pool) {
+    return pool->num_threads;
+}
+
+void free_thread_pool(ThreadPool* pool) {
+    if (pool == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->shutting_down = 1;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int i=1; i < pool->num_threads; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->work_done);
+    free(pool->threads);
+    free(pool->workers);
+    free(pool);
+}
\ No newline at end of file
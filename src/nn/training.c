@@ -1,146 +1,566 @@
+#include <stdio.h>
+#include <stdlib.h>
 #include "nn/training.h"
 #include "nn/neural_network.h"
+#include "nn/thread_pool.h"
 #include "nn/lr_schedule.h"
+#include "nn/optimizer.h"
+#include "nn/telemetry.h"
 #include "maths/matrix.h"
+#include "maths/aligned_buffer.h"
 #include "maths/activation.h"
 #include "maths/softmax.h"
 #include "maths/loss.h"
 
-static Matrix mean_rows(const Matrix* matrix) {
-    // Returns a column vector, with each element as the mean of the corresponding row in the input matrix.
-    Matrix result = create_matrix(matrix->rows, 1);
+// Number of rows of a column-major matrix whose sums mean_rows_into accumulates at once.
+#define MEAN_ROWS_BLOCK 64
+
+static void mean_rows_into(Matrix* result, const Matrix* matrix) {
+    // Writes a column vector into result, with each element as the mean of the corresponding row in the
+    // input matrix. The rows of a column-major matrix are summed a block of rows at a time, walking down each
+    // column of the block, so that its elements are read in the order they are stored.
+    if (matrix->layout == MATRIX_COL_MAJOR) {
+        double sums[MEAN_ROWS_BLOCK];
+        for (int first_row=0; first_row < matrix->rows; first_row += MEAN_ROWS_BLOCK) {
+            int block_rows = (matrix->rows - first_row < MEAN_ROWS_BLOCK) ? matrix->rows - first_row :
+                MEAN_ROWS_BLOCK;
+            for (int i=0; i < block_rows; i++) {
+                sums[i] = 0.0;
+            }
+            for (int col_count=0; col_count < matrix->cols; col_count++) {
+                const Scalar* col = &matrix->data[(size_t)col_count * matrix->stride + first_row];
+                for (int i=0; i < block_rows; i++) {
+                    sums[i] += col[i];
+                }
+            }
+            for (int i=0; i < block_rows; i++) {
+                set_element(result, first_row + i, 0, sums[i] / matrix->cols);
+            }
+        }
+        return;
+    }
+
     for (int row_count=0; row_count < matrix->rows; row_count++) {
+        const Scalar* row = &matrix->data[row_count * matrix->stride];
         double sum = 0.0;
         for (int col_count=0; col_count < matrix->cols; col_count++) {
-            sum += get_element(matrix, row_count, col_count);
+            sum += row[col_count];
         }
         double avg = sum / matrix->cols;
 
-        set_element(&result, row_count, 0, avg);
+        set_element(result, row_count, 0, avg);
     }
-
-    return result;
 }
 
-static void backpropagation(Network* net, const Matrix* input, const Matrix* loss_deriv) { 
-    Layer* output_layer= &net->layers[net->num_layers-1];
+// Wall-clock time spent in each phase of training, accumulated over an epoch. The per-layer arrays each have
+// one element per layer, or are NULL if per-layer times are not being recorded.
+typedef struct PhaseTimer {
+    double forward_seconds;
+    double backward_seconds;
+    double optimizer_seconds;
+    double loss_seconds;
 
-    // Freeing derivative matrices before overwriting
-    free_matrix(&output_layer->dL_dz);
-    free_matrix(&output_layer->dL_dw);
-    free_matrix(&output_layer->dL_db);
+    double* layer_forward_seconds;
+    double* layer_backward_seconds;
+    double* layer_optimizer_seconds;
+} PhaseTimer;
 
+static void activation_backward(Layer* layer) {
     // dL_dz = dL_da * da_dz
-    if (output_layer->activation == &softmax) {
-        output_layer->dL_dz = softmax_derivative(&output_layer->a, loss_deriv);
+    if (layer->activation == &softmax) {
+        softmax_derivative_into(&layer->dL_dz, &layer->a, &layer->dL_da);
     }
     else {
-        Matrix dL_da = copy_matrix(loss_deriv);
-        Matrix da_dz = copy_matrix(&output_layer->z);
-        apply_func(&da_dz, output_layer->activation->derivative_ptr);
-        output_layer->dL_dz = hadamard_product(&dL_da, &da_dz);
-        free_matrix(&dL_da);
-        free_matrix(&da_dz);
+        // The derivative is calculated from the activations kept from the forward pass, and multiplied by
+        // dL_da in the same pass, rather than evaluating the activation function again from z. The matrices
+        // share a layout, and are visited in storage order through their storage views, all at once if each is
+        // contiguous.
+        Matrix a = matrix_storage_view(&layer->a);
+        Matrix dL_da = matrix_storage_view(&layer->dL_da);
+        Matrix dL_dz = matrix_storage_view(&layer->dL_dz);
+        if (a.stride == a.cols && dL_da.stride == a.cols && dL_dz.stride == a.cols) {
+            layer->activation->backward_ptr(a.data, dL_da.data, dL_dz.data, a.rows * a.cols);
+            return;
+        }
+
+        for (int row_count=0; row_count < a.rows; row_count++) {
+            const Scalar* a_row = &a.data[row_count * a.stride];
+            const Scalar* dL_da_row = &dL_da.data[row_count * dL_da.stride];
+            Scalar* dL_dz_row = &dL_dz.data[row_count * dL_dz.stride];
+            layer->activation->backward_ptr(a_row, dL_da_row, dL_dz_row, a.cols);
+        }
     }
+}
 
-    // dL_dw = dL_dz * dz_dw
-    Matrix dz_dw;
-    if (net->num_layers > 1) {
-        dz_dw = transpose(&net->layers[net->num_layers-2].a);
+static double output_layer_backward(Layer* output_layer, const Matrix* expected_output, const LossFunc* loss_func,
+    MathAccuracy accuracy) {
+    // Writes the derivative of the loss with respect to the output layer's pre-activation output into its
+    // dL_dz, and returns the loss, which is calculated in the same pass over the outputs. For softmax with CCE
+    // and sigmoid with BCE, the loss and activation derivatives simplify to a closed form when multiplied
+    // together, which avoids both the division by the (clipped) predictions and, for softmax, the product with
+    // its Jacobian.
+    if (output_layer->activation == &softmax && loss_func == &CCE) {
+        return softmax_cross_entropy_gradient_into(&output_layer->dL_dz, expected_output, &output_layer->a,
+            accuracy);
+    }
+    else if (output_layer->activation == &sigmoid && loss_func == &BCE) {
+        return sigmoid_binary_cross_entropy_gradient_into(&output_layer->dL_dz, expected_output, &output_layer->a,
+            accuracy);
     }
     else {
-        dz_dw = transpose(input);
+        double loss = loss_func->with_derivative_into_ptr(&output_layer->dL_da, expected_output, &output_layer->a);
+        activation_backward(output_layer);
+        return loss;
     }
-    output_layer->dL_dw = matrix_multiplication(&output_layer->dL_dz, &dz_dw);
-    free_matrix(&dz_dw);
-
-    // dL_db = dL_dz * dz_db = dL_dz * 1
-    output_layer->dL_db = mean_rows(&output_layer->dL_dz);
+}
 
-    for (int layer_count=net->num_layers-2; layer_count >= 0; layer_count--) {
+static void backpropagation(Network* net, const Matrix* input, double* layer_seconds) { 
+    // Expects the output layer's dL_dz to already hold the derivative of the loss with respect to its
+    // pre-activation output. All derivative matrices are written in place into the network's workspace, where
+    // the forward pass has already sized them for the batch. If layer_seconds is not NULL, the time spent on
+    // each layer is added onto its element.
+    for (int layer_count=net->num_layers-1; layer_count >= 0; layer_count--) {
         Layer* curr_layer = &net->layers[layer_count];
-        Layer* next_layer = &net->layers[layer_count+1];
-        
-        // Freeing derivative matrices before overwriting
-        free_matrix(&curr_layer->dL_dz);
-        free_matrix(&curr_layer->dL_dw);
-        free_matrix(&curr_layer->dL_db);
-
-        // dL_dz = dL_da * da_dz
-        // dL_da = dL_dz{next} * dz{next}_da
-        Matrix w_T = transpose(&next_layer->weights);
-        Matrix dL_da = matrix_multiplication(&w_T, &next_layer->dL_dz);
-        free_matrix(&w_T);
-        Matrix da_dz = copy_matrix(&curr_layer->z);
-        apply_func(&da_dz, curr_layer->activation->derivative_ptr);
-        curr_layer->dL_dz = hadamard_product(&dL_da, &da_dz);
-        free_matrix(&dL_da);
-        free_matrix(&da_dz);
-
-        // dL_dw = dL_dz * dz_dw
-        if (layer_count > 0) {
-            dz_dw = transpose(&net->layers[layer_count-1].a);
-        }
-        else {
-            dz_dw = transpose(input);
-        }
-        curr_layer->dL_dw = matrix_multiplication(&curr_layer->dL_dz, &dz_dw);
-        free_matrix(&dz_dw);
+        double layer_start = (layer_seconds != NULL) ? wall_time_seconds() : 0.0;
+
+        // With checkpointing, the layer's input (and the outputs below it) may need recomputing first.
+        recompute_layer_inputs(net, input, layer_count);
+
+        // dL_da = dL_dz{next} * dz{next}_da, and then dL_dz = dL_da * da_dz, for every layer except the output
+        // layer
+        if (layer_count < net->num_layers-1) {
+            Layer* next_layer = &net->layers[layer_count+1];
+            matrix_multiplication_transposed_into(&curr_layer->dL_da, &next_layer->weights, 1,
+                &next_layer->dL_dz, 0);
+            activation_backward(curr_layer);
+        }
+
+        // dL_dw = dL_dz * dz_dw, where dz_dw is the transpose of the layer's input
+        const Matrix* layer_input = (layer_count > 0) ? &net->layers[layer_count-1].a : input;
+        matrix_multiplication_transposed_into(&curr_layer->dL_dw, &curr_layer->dL_dz, 0, layer_input, 1);
 
         // dL_db = dL_dz * dz_db = dL_dz * 1
-        curr_layer->dL_db = mean_rows(&curr_layer->dL_dz);
+        mean_rows_into(&curr_layer->dL_db, &curr_layer->dL_dz);
+
+        if (layer_seconds != NULL) {
+            layer_seconds[layer_count] += wall_time_seconds() - layer_start;
+        }
     }
 }
 
-static void gradient_descent(Network* net, double learning_rate) {
-    // Updates the weights and biases of each layer based on gradients calculated from backpropagation
-    // and the learning rate.
-    for (int layer_count=0; layer_count < net->num_layers; layer_count++) {
-        Layer* curr_layer = &net->layers[layer_count];
+static double compute_gradients(Network* net, const Matrix* input, const Matrix* expected_output,
+    const LossFunc* loss_func, PhaseTimer* timer) {
+    // Runs the forward pass, loss calculation and backward pass, leaving the gradients of the loss with respect
+    // to every layer's weights and biases in dL_dw and dL_db, and returns the loss over the batch. If timer is
+    // not NULL, the time spent on each phase is added onto it.
+    double start = wall_time_seconds();
+    forward_pass_timed(net, input, (timer != NULL) ? timer->layer_forward_seconds : NULL);
+    double forward_end = wall_time_seconds();
 
-        Matrix diff = matrix_scalar_multiplication(&curr_layer->dL_dw, -learning_rate);
-        Matrix new_weights = matrix_addition(&curr_layer->weights, &diff);
-        free_matrix(&curr_layer->weights);
-        free_matrix(&diff);
-        curr_layer->weights = copy_matrix(&new_weights);
-        free_matrix(&new_weights);
+    // The loss derivative is the starting point of backpropagation, so is written into the output layer.
+    double loss = output_layer_backward(&net->layers[net->num_layers-1], expected_output, loss_func,
+        net->math_accuracy);
+    double loss_end = wall_time_seconds();
+
+    backpropagation(net, input, (timer != NULL) ? timer->layer_backward_seconds : NULL);
+
+    if (timer != NULL) {
+        timer->forward_seconds += forward_end - start;
+        timer->loss_seconds += loss_end - forward_end;
+        timer->backward_seconds += wall_time_seconds() - loss_end;
+    }
+    return loss;
+}
 
-        diff = matrix_scalar_multiplication(&curr_layer->dL_db, -learning_rate);
-        Matrix new_biases = matrix_addition(&curr_layer->biases, &diff);
-        free_matrix(&curr_layer->biases);
-        free_matrix(&diff);
-        curr_layer->biases = copy_matrix(&new_biases);
-        free_matrix(&new_biases);
+static void update_parameters(Network* net, const Optimizer* optimizer, double learning_rate, int step,
+    PhaseTimer* timer) {
+    double start = wall_time_seconds();
+    optimizer_step_timed(net, optimizer, learning_rate, step,
+        (timer != NULL) ? timer->layer_optimizer_seconds : NULL);
+    if (timer != NULL) {
+        timer->optimizer_seconds += wall_time_seconds() - start;
     }
 }
 
-static void train_step(Network* net, const Matrix* input, const Matrix* expected_output, 
-    const LossFunc* loss_func, double learning_rate) {
+static double timed_train_step(Network* net, const Matrix* input, const Matrix* expected_output,
+    const LossFunc* loss_func, const Optimizer* optimizer, double learning_rate, int step, PhaseTimer* timer) {
+    double loss = compute_gradients(net, input, expected_output, loss_func, timer);
+    update_parameters(net, optimizer, learning_rate, step, timer);
+    return loss;
+}
+
+double train_step(Network* net, const Matrix* input, const Matrix* expected_output, const LossFunc* loss_func,
+    const Optimizer* optimizer, double learning_rate, int step) {
     // Performs one training step: forward pass, loss calculation, backward pass, and parameter updates.
-    Matrix output = forward_pass(net, input);
+    return timed_train_step(net, input, expected_output, loss_func, optimizer, learning_rate, step, NULL);
+}
+
+// State shared by the workers of a data-parallel training step. Each worker runs on its own network: worker 0
+// uses the network being trained, and every other worker a replica of it, which shares its weights and biases
+// but has its own workspace.
+typedef struct ParallelTrainer {
+    ThreadPool* pool;
+    Network** worker_nets;
+    Network* replicas; // Networks of workers 1 onwards
+    int num_workers;
 
-    Matrix loss_deriv = loss_func->derivative_ptr(expected_output, &output);
-    backpropagation(net, input, &loss_deriv);
-    
-    free_matrix(&output);
-    free_matrix(&loss_deriv);
+    // The batch of the current step, split into one shard of consecutive columns per active replica.
+    const Matrix* input;
+    const Matrix* expected_output;
+    const LossFunc* loss_func;
+    int num_shards;
+    double* shard_losses; // Loss of each shard's samples, weighted by the shard's fraction of the batch
+    PhaseTimer* timer; // Records the phases of worker 0, which runs on the calling thread
 
-    gradient_descent(net, learning_rate);
+    int reduction_stride; // Distance between the pairs of workers combined in the current reduction level
+} ParallelTrainer;
+
+static void shard_columns(int num_samples, int num_shards, int shard, int* first_col, int* num_cols) {
+    // Splits num_samples columns into num_shards consecutive ranges whose sizes differ by at most one.
+    int start = (int)((long)num_samples * shard / num_shards);
+    int end = (int)((long)num_samples * (shard + 1) / num_shards);
+    *first_col = start;
+    *num_cols = end - start;
 }
 
-void training_loop(Network* net, int num_epoch, const Matrix* input, const Matrix* expected_output, 
-    const LossFunc* loss_func, const LearningRateSchedule* lr_schedule, TrainingReport report_progress,
-    int report_freq) {
+static void compute_shard_gradients(void* arg, int worker_index) {
+    // Computes one worker's gradients over its shard of the batch, scaled to its share of the batch gradient.
+    ParallelTrainer* trainer = arg;
+    if (worker_index >= trainer->num_shards) {
+        return;
+    }
+    Network* worker_net = trainer->worker_nets[worker_index];
+
+    int first_col, num_cols;
+    shard_columns(trainer->input->cols, trainer->num_shards, worker_index, &first_col, &num_cols);
+    Matrix input_shard = matrix_column_view(trainer->input, first_col, num_cols);
+    Matrix expected_shard = matrix_column_view(trainer->expected_output, first_col, num_cols);
+
+    PhaseTimer* timer = (worker_index == 0) ? trainer->timer : NULL;
+    double loss = compute_gradients(worker_net, &input_shard, &expected_shard, trainer->loss_func, timer);
+    double scale_start = wall_time_seconds();
+
+    // Each loss is a mean over its samples, so the shard's dL_dz carries a factor of 1/num_cols where the
+    // whole batch's would carry 1/batch_cols. dL_dw is linear in dL_dz, and dL_db is a further mean over the
+    // shard's columns, so they are weighted by the shard's fraction of the batch and its square respectively.
+    double fraction = (double)num_cols / trainer->input->cols;
+    trainer->shard_losses[worker_index] = loss * fraction;
+    for (int layer_count=0; layer_count < worker_net->num_layers; layer_count++) {
+        Layer* curr_layer = &worker_net->layers[layer_count];
+        matrix_scalar_multiplication_into(&curr_layer->dL_dw, &curr_layer->dL_dw, fraction);
+        matrix_scalar_multiplication_into(&curr_layer->dL_db, &curr_layer->dL_db, fraction * fraction);
+    }
+    if (timer != NULL) {
+        timer->backward_seconds += wall_time_seconds() - scale_start;
+    }
+}
+
+static void reduce_gradients_level(void* arg, int worker_index) {
+    // Adds the gradients of worker (worker_index + stride) onto those of worker worker_index, for every
+    // worker_index that is a multiple of twice the stride.
+    ParallelTrainer* trainer = arg;
+    int stride = trainer->reduction_stride;
+    if (worker_index % (2 * stride) != 0 || worker_index + stride >= trainer->num_shards) {
+        return;
+    }
+
+    Network* dest = trainer->worker_nets[worker_index];
+    const Network* src = trainer->worker_nets[worker_index + stride];
+    for (int layer_count=0; layer_count < dest->num_layers; layer_count++) {
+        matrix_axpy(&dest->layers[layer_count].dL_dw, 1.0, &src->layers[layer_count].dL_dw);
+        matrix_axpy(&dest->layers[layer_count].dL_db, 1.0, &src->layers[layer_count].dL_db);
+    }
+}
+
+static double parallel_train_step(ParallelTrainer* trainer, const Matrix* input, const Matrix* expected_output,
+    const LossFunc* loss_func, const Optimizer* optimizer, double learning_rate, int step, PhaseTimer* timer) {
+    // Performs one training step with the batch split across the workers, and returns the loss over the batch.
+    // The shards' gradients are combined into worker 0's network by a tree reduction, in which the pairs added
+    // together at each level (and the order of the additions) depend only on the number of shards, so results do
+    // not vary between runs.
+    trainer->input = input;
+    trainer->expected_output = expected_output;
+    trainer->loss_func = loss_func;
+    trainer->num_shards = (input->cols < trainer->num_workers) ? input->cols : trainer->num_workers;
+    trainer->timer = timer;
+
+    run_on_thread_pool(trainer->pool, compute_shard_gradients, trainer);
+
+    // Summing the gradients is counted as part of the backward pass.
+    double reduction_start = wall_time_seconds();
+    for (int stride=1; stride < trainer->num_shards; stride *= 2) {
+        trainer->reduction_stride = stride;
+        run_on_thread_pool(trainer->pool, reduce_gradients_level, trainer);
+    }
+    timer->backward_seconds += wall_time_seconds() - reduction_start;
+
+    update_parameters(trainer->worker_nets[0], optimizer, learning_rate, step, timer);
+
+    // Every loss is a mean over the samples, so the batch's loss is the sum of the shards' weighted losses.
+    double loss = 0.0;
+    for (int i=0; i < trainer->num_shards; i++) {
+        loss += trainer->shard_losses[i];
+    }
+    return loss;
+}
+
+static int create_parallel_trainer(ParallelTrainer* trainer, Network* net, int num_threads, int batch_size) {
+    // Starts the thread pool and creates a replica of the network for each worker after the first, with
+    // workspaces sized for the largest shard of a batch. Returns 0 if any allocation failed, and 1 otherwise.
+    trainer->pool = create_thread_pool(num_threads);
+    if (trainer->pool == NULL) {
+        return 0;
+    }
+
+    // The pool may have started fewer threads than requested.
+    num_threads = thread_pool_size(trainer->pool);
+    trainer->num_workers = num_threads;
+    trainer->worker_nets = calloc(num_threads, sizeof(Network*));
+    trainer->replicas = calloc(num_threads, sizeof(Network));
+    trainer->shard_losses = calloc(num_threads, sizeof(double));
+    if (trainer->worker_nets == NULL || trainer->replicas == NULL || trainer->shard_losses == NULL) {
+        return 0;
+    }
+
+    int max_shard = (batch_size + num_threads - 1) / num_threads;
+    trainer->worker_nets[0] = net;
+    for (int i=1; i < num_threads; i++) {
+        trainer->replicas[i-1] = create_replica(net);
+        trainer->worker_nets[i] = &trainer->replicas[i-1];
+        if (trainer->replicas[i-1].layers == NULL || !reserve_workspace(trainer->worker_nets[i], max_shard)) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static void free_parallel_trainer(ParallelTrainer* trainer) {
+    // Stops the thread pool and frees the replicas, leaving the network being trained untouched.
+    if (trainer->pool != NULL) {
+        free_thread_pool(trainer->pool);
+    }
+    if (trainer->replicas != NULL) {
+        for (int i=0; i < trainer->num_workers - 1; i++) {
+            free_replica(&trainer->replicas[i]);
+        }
+    }
+    free(trainer->replicas);
+    free(trainer->worker_nets);
+    free(trainer->shard_losses);
+}
+
+static void swap_columns(Matrix* matrix, int col_a, int col_b) {
+    // Columns of a column-major matrix are contiguous, so are swapped directly.
+    if (matrix->layout == MATRIX_COL_MAJOR) {
+        Scalar* a = &matrix->data[(size_t)col_a * matrix->stride];
+        Scalar* b = &matrix->data[(size_t)col_b * matrix->stride];
+        for (int row_count=0; row_count < matrix->rows; row_count++) {
+            Scalar temp = a[row_count];
+            a[row_count] = b[row_count];
+            b[row_count] = temp;
+        }
+        return;
+    }
+
+    for (int row_count=0; row_count < matrix->rows; row_count++) {
+        Scalar temp = get_element(matrix, row_count, col_a);
+        set_element(matrix, row_count, col_a, get_element(matrix, row_count, col_b));
+        set_element(matrix, row_count, col_b, temp);
+    }
+}
+
+static void shuffle_samples(Matrix* input, Matrix* expected_output) {
+    // Shuffles the samples (columns) of a dataset in place using a Fisher-Yates shuffle, applying the same
+    // permutation to the inputs and expected outputs so that each sample stays matched with its label.
+    for (int i=input->cols-1; i > 0; i--) {
+        int j = rand() % (i + 1);
+        swap_columns(input, i, j);
+        swap_columns(expected_output, i, j);
+    }
+}
+
+static int effective_batch_size(int batch_size, int num_samples) {
+    // A batch size of 0 (or one larger than the dataset) means the whole dataset is a single batch.
+    return (batch_size <= 0 || batch_size > num_samples) ? num_samples : batch_size;
+}
+
+double calc_dataset_loss(const Network* net, const Matrix* input, const Matrix* expected_output,
+    const LossFunc* loss_func, int batch_size) {
+    int num_samples = input->cols;
+    batch_size = effective_batch_size(batch_size, num_samples);
+
+    // The loss only needs the network's output, so uses the inference path, with the output and scratch
+    // allocated once and reused for every batch.
+    Matrix output_buffer = create_uninitialised_matrix(expected_output->rows, batch_size,
+        expected_output->layout);
+    InferenceScratch scratch = {NULL, 0, 0};
+
+    // Every loss function is a mean over the samples, so the loss over the whole dataset is the mean of the
+    // batch losses weighted by the number of samples in each batch.
+    double weighted_sum = 0.0;
+    for (int first_col=0; first_col < num_samples; first_col += batch_size) {
+        int batch_cols = (num_samples - first_col < batch_size) ? num_samples - first_col : batch_size;
+        Matrix input_batch = matrix_column_view(input, first_col, batch_cols);
+        Matrix expected_batch = matrix_column_view(expected_output, first_col, batch_cols);
+
+        Matrix output = matrix_view_with_layout(output_buffer.data, expected_output->rows, batch_cols,
+            expected_output->layout);
+        predict_into(&output, net, &input_batch, &scratch);
+        weighted_sum += loss_func->func_ptr(&expected_batch, &output) * batch_cols;
+    }
+
+    free_inference_scratch(&scratch);
+    free_matrix(&output_buffer);
+    return weighted_sum / num_samples;
+}
+
+static size_t training_bytes(const Network* net, const ParallelTrainer* trainer, int parallel) {
+    // Memory held for training: the workspaces of the network and any replicas, and the optimizer state.
+    size_t bytes = workspace_bytes(net) + optimizer_state_bytes(net);
+    if (parallel) {
+        for (int i=0; i < trainer->num_workers - 1; i++) {
+            bytes += workspace_bytes(&trainer->replicas[i]);
+        }
+    }
+    return bytes;
+}
+
+static void report_epoch(const TrainingMonitor* monitor, const PhaseTimer* timer, EpochStats* stats,
+    LayerStats* layer_stats) {
+    // Completes an epoch's stats from its timer, and delivers them to the callback and the log.
+    stats->forward_seconds = timer->forward_seconds;
+    stats->backward_seconds = timer->backward_seconds;
+    stats->optimizer_seconds = timer->optimizer_seconds;
+    stats->loss_seconds = timer->loss_seconds;
+    stats->samples_per_second = (stats->wall_seconds > 0) ? stats->samples / stats->wall_seconds : 0.0;
+
+    if (layer_stats != NULL) {
+        for (int i=0; i < stats->num_layers; i++) {
+            layer_stats[i].forward_seconds = timer->layer_forward_seconds[i];
+            layer_stats[i].backward_seconds = timer->layer_backward_seconds[i];
+            layer_stats[i].optimizer_seconds = timer->layer_optimizer_seconds[i];
+        }
+    }
+    stats->layers = layer_stats;
+
+    if (monitor->callback != NULL) {
+        monitor->callback(stats, monitor->user_data);
+    }
+    if (monitor->log != NULL) {
+        write_epoch_stats(monitor->log, monitor->log_format, stats);
+    }
+}
+
+void training_loop(Network* net, int num_epoch, Matrix* input, Matrix* expected_output, 
+    const LossFunc* loss_func, const LearningRateSchedule* lr_schedule, const Optimizer* optimizer,
+    const TrainingOptions* options, const TrainingMonitor* monitor) {
+
+    int num_samples = input->cols;
+    int batch_size = effective_batch_size(options->batch_size, num_samples);
+
+    // The workspace is planned for the memory mode before anything uses it, including any replicas.
+    set_workspace_memory(net, options->lean_memory, options->checkpoint_interval);
+
+    // The optimizer state is allocated up front, next to each layer's parameters, so no step allocates.
+    if (!init_optimizer_state(net, optimizer)) {
+        return;
+    }
+
+    // Per-layer times are kept in one array, split into the forward, backward and optimizer times of each
+    // layer, and copied into layer_stats at the end of each epoch.
+    double* layer_seconds = NULL;
+    LayerStats* layer_stats = NULL;
+    if (monitor->per_layer) {
+        layer_seconds = malloc(3 * (size_t)net->num_layers * sizeof(double));
+        layer_stats = malloc((size_t)net->num_layers * sizeof(LayerStats));
+        if (layer_seconds == NULL || layer_stats == NULL) {
+            printf("Memory allocation failed, per-layer times will not be recorded.\n");
+            free(layer_seconds);
+            free(layer_stats);
+            layer_seconds = NULL;
+            layer_stats = NULL;
+        }
+    }
+
+    // With more than one thread, each batch is split across a pool of workers, each with its own replica of
+    // the network. Training falls back to a single thread if the pool cannot be set up.
+    ParallelTrainer trainer = {0};
+    int parallel = 0;
+    if (options->num_threads > 1) {
+        parallel = create_parallel_trainer(&trainer, net, options->num_threads, batch_size);
+        if (!parallel) {
+            printf("Failed to start %d training threads, training on a single thread.\n", options->num_threads);
+            free_parallel_trainer(&trainer);
+        }
+    }
 
     double learning_rate = lr_schedule->base_lr;
+    int step = 0;
     for (int epoch_count=0; epoch_count < num_epoch; epoch_count++) {
-        train_step(net, input, expected_output, loss_func, learning_rate);
-        learning_rate = update_learning_rate(epoch_count, lr_schedule);
-        if ((epoch_count+1) % report_freq == 0 || epoch_count + 1 == num_epoch) {
-            Matrix output = forward_pass(net, input);
-            double loss_val = loss_func->func_ptr(expected_output, &output);
-            free_matrix(&output);
-            report_progress(epoch_count+1, num_epoch, loss_val);
+        double epoch_start = wall_time_seconds();
+        BufferStats buffers_at_start = buffer_stats();
+        PhaseTimer timer = {0};
+        if (layer_seconds != NULL) {
+            for (int i=0; i < 3 * net->num_layers; i++) {
+                layer_seconds[i] = 0.0;
+            }
+            timer.layer_forward_seconds = layer_seconds;
+            timer.layer_backward_seconds = layer_seconds + net->num_layers;
+            timer.layer_optimizer_seconds = layer_seconds + 2 * net->num_layers;
+        }
+
+        EpochStats stats = {0};
+        stats.epoch = epoch_count + 1;
+        stats.num_epoch = num_epoch;
+        stats.samples = num_samples;
+        stats.num_layers = net->num_layers;
+
+        if (options->shuffle) {
+            shuffle_samples(input, expected_output);
+        }
+        double weighted_loss_sum = 0.0;
+
+        // Each batch is a view of consecutive columns of the dataset, so no samples are copied, and for a
+        // column-major dataset (as loaded from a .csv) is one contiguous block of memory. The final
+        // batch of an epoch holds any remaining samples, so may be smaller than the others.
+        for (int first_col=0; first_col < num_samples; first_col += batch_size) {
+            int batch_cols = (num_samples - first_col < batch_size) ? num_samples - first_col : batch_size;
+            Matrix input_batch = matrix_column_view(input, first_col, batch_cols);
+            Matrix expected_batch = matrix_column_view(expected_output, first_col, batch_cols);
+
+            step++;
+            stats.steps++;
+            double batch_loss;
+            if (parallel) {
+                batch_loss = parallel_train_step(&trainer, &input_batch, &expected_batch, loss_func, optimizer,
+                    learning_rate, step, &timer);
+            }
+            else {
+                batch_loss = timed_train_step(net, &input_batch, &expected_batch, loss_func, optimizer,
+                    learning_rate, step, &timer);
+            }
+            weighted_loss_sum += batch_loss * batch_cols;
         }
+
+        // The loss of each batch is calculated by its training step, so the epoch's loss is their mean weighted
+        // by the number of samples in each, without another pass over the dataset. Each batch's loss is from
+        // before its own update, so this lags slightly behind the loss at the end of the epoch.
+        stats.loss = weighted_loss_sum / num_samples;
+
+        learning_rate = update_learning_rate(epoch_count, lr_schedule);
+
+        stats.wall_seconds = wall_time_seconds() - epoch_start;
+        stats.bytes_allocated = training_bytes(net, &trainer, parallel);
+        BufferStats buffers_at_end = buffer_stats();
+        stats.buffer_allocations = buffers_at_end.allocations - buffers_at_start.allocations;
+        stats.system_allocations = buffers_at_end.system_allocations - buffers_at_start.system_allocations;
+        report_epoch(monitor, &timer, &stats, layer_stats);
+    }
+
+    if (parallel) {
+        free_parallel_trainer(&trainer);
     }
+    free(layer_seconds);
+    free(layer_stats);
 }
\ No newline at end of file